@@ -0,0 +1,206 @@
+#include "../src/hg/Core/Engine.hpp"
+#include "../src/hg/Scene/Scene.hpp"
+#include "../src/hg/Scene/PhysicsWorld.hpp"
+#include "../src/hg/Scene/RigidBody.hpp"
+#include "../src/hg/Renderer2D/RenderSystem2D.hpp"
+#include "hd/Core/JSON.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Runs synthetic workloads over the engine subsystems without window and GPU.
+// Usage: HgEngineBench [output.json] [entities counts...]
+// Results are printed to stdout as JSON and written to the output file if given
+
+namespace hg {
+
+// Generates one render op per update like Sprite does, but without a texture
+class BenchSprite : public Component {
+    HG_OBJECT(BenchSprite, Component);
+public:
+    void onUpdate(float dt) override {
+        GameObject *owner = getOwner();
+        getRenderSystem2D().drawTexture(nullptr, glm::vec3(owner->getWorldPosition(), 0.0f), owner->getSize(), owner->getWorldAngle());
+    }
+};
+
+}
+
+namespace {
+
+struct BenchResult {
+    std::string name;
+    size_t entities = 0;
+    size_t iterations = 0;
+    double meanMs = 0.0, minMs = 0.0, maxMs = 0.0;
+};
+
+const double MIN_BENCH_TIME_MS = 500.0;
+const size_t MIN_ITERATIONS = 3;
+const size_t MAX_ITERATIONS = 1000;
+
+double getElapsedMs(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// setup runs before every iteration and isn't measured
+BenchResult runBench(const std::string &name, size_t entities, const std::function<void()> &setup, const std::function<void()> &body) {
+    BenchResult result;
+    result.name = name;
+    result.entities = entities;
+    result.minMs = 1e300;
+
+    double totalMs = 0.0;
+    while ((totalMs < MIN_BENCH_TIME_MS || result.iterations < MIN_ITERATIONS) && result.iterations < MAX_ITERATIONS) {
+        if (setup) {
+            setup();
+        }
+        auto begin = std::chrono::steady_clock::now();
+        body();
+        double ms = getElapsedMs(begin);
+
+        totalMs += ms;
+        result.minMs = std::min(result.minMs, ms);
+        result.maxMs = std::max(result.maxMs, ms);
+        result.iterations++;
+    }
+    result.meanMs = totalMs / result.iterations;
+
+    std::fprintf(stderr, "%-24s %8zu entities: %10.3f ms (min %.3f, max %.3f, %zu iterations)\n",
+        name.c_str(), entities, result.meanMs, result.minMs, result.maxMs, result.iterations);
+    return result;
+}
+
+void populate(hg::Scene &scene, size_t count, bool withBodies) {
+    scene.clear();
+    if (withBodies) {
+        scene.createComponent<hg::PhysicsWorld>()->setGravity(glm::vec2(0.0f, -9.8f));
+    }
+
+    const size_t side = static_cast<size_t>(std::sqrt(static_cast<double>(count))) + 1;
+    for (size_t i = 0; i < count; i++) {
+        hg::GameObject *go = scene.createChild();
+        go->setName("entity");
+        go->setSize(0.5f, 0.5f);
+        go->setPosition(static_cast<float>(i % side), static_cast<float>(i / side));
+        go->createComponent<hg::BenchSprite>();
+        if (withBodies) {
+            go->createComponent<hg::RigidBody>()->setType(hg::BodyType::Dynamic);
+        }
+    }
+    scene.onUpdate(0.0f); // flush onFirstUpdate
+    hg::getRenderSystem2D().onUpdate(0.0f);
+}
+
+void runBenches(size_t count, std::vector<BenchResult> &results) {
+    hg::Scene &scene = hg::getScene();
+    hg::RenderSystem2D &renderSystem = hg::getRenderSystem2D();
+
+    results.push_back(runBench("scene_populate", count, [&] { scene.clear(); }, [&] {
+        populate(scene, count, false);
+    }));
+
+    populate(scene, count, false);
+    results.push_back(runBench("transform_update", count, nullptr, [&] {
+        for (auto &go : scene.getChildren()) {
+            go->translate(0.01f, 0.0f);
+        }
+    }));
+
+    results.push_back(runBench("scene_update_render_ops", count, nullptr, [&] {
+        scene.onUpdate(1.0f / 60.0f);
+        renderSystem.onUpdate(1.0f / 60.0f);
+    }));
+
+    results.push_back(runBench("json_save", count, nullptr, [&] {
+        scene.save("bench.json");
+    }));
+
+    results.push_back(runBench("json_load", count, nullptr, [&] {
+        scene.load("bench.json");
+    }));
+
+    results.push_back(runBench("binary_save", count, nullptr, [&] {
+        scene.saveBinary("bench.hgba");
+    }));
+
+    results.push_back(runBench("binary_load", count, nullptr, [&] {
+        scene.load("bench.hgba");
+    }));
+
+    results.push_back(runBench("deferred_destroy", count, [&] { populate(scene, count, false); }, [&] {
+        for (auto &go : scene.getChildren()) {
+            go->destroyDeferred();
+        }
+        scene.onUpdate(0.0f);
+    }));
+
+    populate(scene, count, true);
+    hg::PhysicsWorld *world = scene.findComponent<hg::PhysicsWorld>();
+    results.push_back(runBench("physics_step", count, nullptr, [&] {
+        world->onUpdate(world->getStepTime());
+    }));
+
+    scene.clear();
+}
+
+}
+
+int main(int argc, char **argv) {
+    std::string outputPath;
+    std::vector<size_t> counts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (!arg.empty() && std::isdigit(static_cast<unsigned char>(arg[0]))) {
+            counts.push_back(std::stoul(arg));
+        }
+        else {
+            outputPath = arg;
+        }
+    }
+    if (counts.empty()) {
+        counts = { 1000, 10000, 100000 };
+    }
+
+    std::filesystem::create_directories("./data/levels");
+
+    hg::EngineCreateInfo createInfo;
+    createInfo.isHeadless = true;
+    hg::getEngine().initialize(createInfo, hg::BaseApp::getTypeHashStatic());
+
+    std::vector<BenchResult> results;
+    for (auto &count : counts) {
+        runBenches(count, results);
+    }
+
+    hg::getEngine().shutdown();
+
+    hd::JSON data;
+    hd::JSON &benchmarks = data["benchmarks"];
+    benchmarks = hd::JSON::array();
+    for (const auto &result : results) {
+        hd::JSON item;
+        item["name"] = result.name;
+        item["entities"] = result.entities;
+        item["iterations"] = result.iterations;
+        item["meanMs"] = result.meanMs;
+        item["minMs"] = result.minMs;
+        item["maxMs"] = result.maxMs;
+        benchmarks.push_back(item);
+    }
+
+    std::string text = data.dump(2);
+    std::cout << text << std::endl;
+    if (!outputPath.empty()) {
+        std::ofstream(outputPath) << text << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,380 @@
+#include "BinaryArchive.hpp"
+#include "hd/Core/Log.hpp"
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+namespace hg {
+
+static const uint8_t gMagic[4] = { 'H', 'G', 'B', 'A' };
+
+enum class ValueTag : uint8_t {
+    Null,
+    False,
+    True,
+    Int,
+    Uint,
+    Float32,
+    Float64,
+    String,
+    Array,
+    Object
+};
+
+static uint32_t computeSchemaHash(const std::vector<std::string> &keys) {
+    uint32_t hash = 2166136261u;
+    for (const auto &key : keys) {
+        for (char c : key) {
+            hash = (hash ^ static_cast<uint8_t>(c))*16777619u;
+        }
+        hash = (hash ^ 0xFFu)*16777619u;
+    }
+    return hash;
+}
+
+class ArchiveWriter {
+public:
+    void writeValue(const hd::JSON &value) {
+        switch (value.type()) {
+            case hd::JSON::value_t::null: {
+                mWriteTag(ValueTag::Null);
+                break;
+            }
+            case hd::JSON::value_t::boolean: {
+                mWriteTag(value.get<bool>() ? ValueTag::True : ValueTag::False);
+                break;
+            }
+            case hd::JSON::value_t::number_integer: {
+                int64_t v = value.get<int64_t>();
+                mWriteTag(ValueTag::Int);
+                mWriteVarint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+                break;
+            }
+            case hd::JSON::value_t::number_unsigned: {
+                mWriteTag(ValueTag::Uint);
+                mWriteVarint(value.get<uint64_t>());
+                break;
+            }
+            case hd::JSON::value_t::number_float: {
+                double v = value.get<double>();
+                float f = static_cast<float>(v);
+                if (static_cast<double>(f) == v) {
+                    mWriteTag(ValueTag::Float32);
+                    mWriteRaw(&f, sizeof(f));
+                }
+                else {
+                    mWriteTag(ValueTag::Float64);
+                    mWriteRaw(&v, sizeof(v));
+                }
+                break;
+            }
+            case hd::JSON::value_t::string: {
+                const std::string &str = value.get_ref<const std::string&>();
+                mWriteTag(ValueTag::String);
+                mWriteString(mBody, str);
+                break;
+            }
+            case hd::JSON::value_t::array: {
+                mWriteTag(ValueTag::Array);
+                mWriteVarint(value.size());
+                for (const auto &it : value) {
+                    writeValue(it);
+                }
+                break;
+            }
+            case hd::JSON::value_t::object: {
+                mWriteTag(ValueTag::Object);
+                mWriteVarint(value.size());
+                for (const auto &it : value.items()) {
+                    mWriteVarint(mGetKeyIndex(it.key()));
+                    writeValue(it.value());
+                }
+                break;
+            }
+            default: {
+                HD_LOG_WARNING("Unsupported JSON value type written to binary archive as null");
+                mWriteTag(ValueTag::Null);
+                break;
+            }
+        }
+    }
+
+    std::vector<uint8_t> finish() {
+        std::vector<uint8_t> result;
+        result.reserve(mBody.size() + 64);
+        result.insert(result.end(), gMagic, gMagic + sizeof(gMagic));
+        uint16_t version = BinaryArchive::VERSION;
+        mWriteRawTo(result, &version, sizeof(version));
+        uint32_t schemaHash = computeSchemaHash(mKeys);
+        mWriteRawTo(result, &schemaHash, sizeof(schemaHash));
+        mWriteVarintTo(result, mKeys.size());
+        for (const auto &key : mKeys) {
+            mWriteString(result, key);
+        }
+        result.insert(result.end(), mBody.begin(), mBody.end());
+        return result;
+    }
+
+private:
+    uint32_t mGetKeyIndex(const std::string &key) {
+        auto it = mKeyIndices.find(key);
+        if (it == mKeyIndices.end()) {
+            it = mKeyIndices.insert(std::make_pair(key, static_cast<uint32_t>(mKeys.size()))).first;
+            mKeys.push_back(key);
+        }
+        return it->second;
+    }
+
+    void mWriteTag(ValueTag tag) {
+        mBody.push_back(static_cast<uint8_t>(tag));
+    }
+
+    void mWriteVarint(uint64_t v) {
+        mWriteVarintTo(mBody, v);
+    }
+
+    void mWriteRaw(const void *data, size_t size) {
+        mWriteRawTo(mBody, data, size);
+    }
+
+    static void mWriteVarintTo(std::vector<uint8_t> &buf, uint64_t v) {
+        while (v >= 0x80) {
+            buf.push_back(static_cast<uint8_t>(v) | 0x80);
+            v >>= 7;
+        }
+        buf.push_back(static_cast<uint8_t>(v));
+    }
+
+    static void mWriteRawTo(std::vector<uint8_t> &buf, const void *data, size_t size) {
+        const uint8_t *bytes = static_cast<const uint8_t*>(data);
+        buf.insert(buf.end(), bytes, bytes + size);
+    }
+
+    static void mWriteString(std::vector<uint8_t> &buf, const std::string &str) {
+        mWriteVarintTo(buf, str.size());
+        mWriteRawTo(buf, str.data(), str.size());
+    }
+
+    std::vector<uint8_t> mBody;
+    std::vector<std::string> mKeys;
+    std::unordered_map<std::string, uint32_t> mKeyIndices;
+};
+
+class ArchiveReader {
+public:
+    explicit ArchiveReader(const std::vector<uint8_t> &buffer) : mData(buffer.data()), mSize(buffer.size()) {
+    }
+
+    bool readHeader() {
+        if (mSize < sizeof(gMagic) || std::memcmp(mData, gMagic, sizeof(gMagic)) != 0) {
+            HD_LOG_ERROR("Failed to read binary archive. Invalid magic");
+            return false;
+        }
+        mOffset = sizeof(gMagic);
+
+        uint16_t version = 0;
+        uint32_t schemaHash = 0;
+        if (!mReadRaw(&version, sizeof(version)) || !mReadRaw(&schemaHash, sizeof(schemaHash))) {
+            return false;
+        }
+        const uint16_t supportedVersion = BinaryArchive::VERSION;
+        if (version != supportedVersion) {
+            HD_LOG_ERROR("Failed to read binary archive. Version {} is not supported, expected {}", version, supportedVersion);
+            return false;
+        }
+
+        uint64_t keysCount = 0;
+        if (!mReadVarint(keysCount) || keysCount > mSize) {
+            return mFail();
+        }
+        mKeys.resize(static_cast<size_t>(keysCount));
+        for (auto &key : mKeys) {
+            if (!mReadString(key)) {
+                return false;
+            }
+        }
+        if (computeSchemaHash(mKeys) != schemaHash) {
+            HD_LOG_ERROR("Failed to read binary archive. Schema hash mismatch");
+            return false;
+        }
+        return true;
+    }
+
+    bool readValue(hd::JSON &value) {
+        uint8_t tag = 0;
+        if (!mReadRaw(&tag, sizeof(tag))) {
+            return false;
+        }
+
+        switch (static_cast<ValueTag>(tag)) {
+            case ValueTag::Null: {
+                value = nullptr;
+                return true;
+            }
+            case ValueTag::False: {
+                value = false;
+                return true;
+            }
+            case ValueTag::True: {
+                value = true;
+                return true;
+            }
+            case ValueTag::Int: {
+                uint64_t v = 0;
+                if (!mReadVarint(v)) {
+                    return false;
+                }
+                value = static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+                return true;
+            }
+            case ValueTag::Uint: {
+                uint64_t v = 0;
+                if (!mReadVarint(v)) {
+                    return false;
+                }
+                value = v;
+                return true;
+            }
+            case ValueTag::Float32: {
+                float v = 0.0f;
+                if (!mReadRaw(&v, sizeof(v))) {
+                    return false;
+                }
+                value = v;
+                return true;
+            }
+            case ValueTag::Float64: {
+                double v = 0.0;
+                if (!mReadRaw(&v, sizeof(v))) {
+                    return false;
+                }
+                value = v;
+                return true;
+            }
+            case ValueTag::String: {
+                std::string str;
+                if (!mReadString(str)) {
+                    return false;
+                }
+                value = std::move(str);
+                return true;
+            }
+            case ValueTag::Array: {
+                uint64_t count = 0;
+                if (!mReadVarint(count) || count > mSize - mOffset) {
+                    return mFail();
+                }
+                value = hd::JSON::array();
+                value.get_ref<hd::JSON::array_t&>().resize(static_cast<size_t>(count));
+                for (auto &it : value) {
+                    if (!readValue(it)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case ValueTag::Object: {
+                uint64_t count = 0;
+                if (!mReadVarint(count) || count > mSize - mOffset) {
+                    return mFail();
+                }
+                value = hd::JSON::object();
+                for (uint64_t i = 0; i < count; i++) {
+                    uint64_t keyIndex = 0;
+                    if (!mReadVarint(keyIndex) || keyIndex >= mKeys.size()) {
+                        return mFail();
+                    }
+                    if (!readValue(value[mKeys[static_cast<size_t>(keyIndex)]])) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            default: {
+                HD_LOG_ERROR("Failed to read binary archive. Unknown value tag {}", tag);
+                return false;
+            }
+        }
+    }
+
+private:
+    bool mFail() {
+        HD_LOG_ERROR("Failed to read binary archive. Data is corrupted at offset {}", mOffset);
+        return false;
+    }
+
+    bool mReadRaw(void *data, size_t size) {
+        if (mSize - mOffset < size) {
+            return mFail();
+        }
+        std::memcpy(data, mData + mOffset, size);
+        mOffset += size;
+        return true;
+    }
+
+    bool mReadVarint(uint64_t &v) {
+        v = 0;
+        for (uint32_t shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = 0;
+            if (!mReadRaw(&byte, sizeof(byte))) {
+                return false;
+            }
+            v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return mFail();
+    }
+
+    bool mReadString(std::string &str) {
+        uint64_t length = 0;
+        if (!mReadVarint(length) || length > mSize - mOffset) {
+            return mFail();
+        }
+        str.assign(reinterpret_cast<const char*>(mData + mOffset), static_cast<size_t>(length));
+        mOffset += static_cast<size_t>(length);
+        return true;
+    }
+
+    const uint8_t *mData;
+    size_t mSize;
+    size_t mOffset = 0;
+    std::vector<std::string> mKeys;
+};
+
+std::vector<uint8_t> BinaryArchive::write(const hd::JSON &data) {
+    ArchiveWriter writer;
+    writer.writeValue(data);
+    return writer.finish();
+}
+
+bool BinaryArchive::read(const std::vector<uint8_t> &buffer, hd::JSON &data) {
+    ArchiveReader reader(buffer);
+    if (!reader.readHeader() || !reader.readValue(data)) {
+        data = hd::JSON();
+        return false;
+    }
+    return true;
+}
+
+bool BinaryArchive::parse(const std::vector<uint8_t> &buffer, hd::JSON &data) {
+    if (isArchive(buffer)) {
+        return read(buffer, data);
+    }
+    else {
+        data = hd::JSON::parse(buffer.begin(), buffer.end(), nullptr, false);
+        if (data.is_discarded()) {
+            HD_LOG_ERROR("Failed to parse JSON text");
+            data = hd::JSON();
+            return false;
+        }
+        return true;
+    }
+}
+
+bool BinaryArchive::isArchive(const std::vector<uint8_t> &buffer) {
+    return buffer.size() >= sizeof(gMagic) && std::memcmp(buffer.data(), gMagic, sizeof(gMagic)) == 0;
+}
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "hd/Core/JSON.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace hg {
+
+// Compact binary encoding of the JSON documents produced by onSaveLoad.
+// Object keys are stored once in a key table guarded by a schema hash and referenced by index,
+// numbers are stored as varints or raw floats, so loading needs no text tokenizing.
+// Reading still produces a JSON document for onSaveLoad, the schema hash only guards the key table
+class BinaryArchive {
+public:
+    static std::vector<uint8_t> write(const hd::JSON &data);
+    static bool read(const std::vector<uint8_t> &buffer, hd::JSON &data);
+
+    // Detects the format by the archive magic and falls back to JSON text. Returns false on corrupted data
+    static bool parse(const std::vector<uint8_t> &buffer, hd::JSON &data);
+    static bool isArchive(const std::vector<uint8_t> &buffer);
+
+    static const uint16_t VERSION = 1;
+};
+
+}
@@ -4,7 +4,13 @@
 #include "../GUI/GUISystem.hpp"
 #include "../Sound/SoundSystem.hpp"
 #include "../Scene/Scene.hpp"
+#include "Profiler.hpp"
+#include "MemoryTracker.hpp"
 #include "hd/Core/Time.hpp"
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <iterator>
 
 namespace hg {
 
@@ -341,13 +347,35 @@ void BaseApp::onUpdate(float dt) {
 Engine::Engine() : mCursorDelta(0, 0) {
     mWindow = nullptr;
     mContext = nullptr;
+    mResourceContext = nullptr;
     mApp = nullptr;
     mIsCenteredCursorMode = false;
+    mFixedDeltaTime = 1.0f / 30.0f;
+    mFixedTimeAccumulator = 0.0f;
+    mInterpolationAlpha = 0.0f;
+    mIsFocused = true;
+    mIsFrameSubmitted = false;
+    mIsRenderThreadExit = false;
+    mFrameFence = nullptr;
+    mIsVSyncModeChanged = false;
 }
 
 void Engine::initialize(const EngineCreateInfo &createInfo, const hd::StringHash &appHash) {
     mTimer = hd::Time::getCurrentTime();
     mCreateInfo = createInfo;
+    mFixedDeltaTime = 1.0f / glm::max(createInfo.fixedUpdateRate, 1.0f);
+    mCreateInfo.maxFixedStepsPerFrame = glm::max(createInfo.maxFixedStepsPerFrame, 1u);
+
+    if (createInfo.isHeadless) {
+        mCreateInfo.isRenderThreadEnabled = false;
+        mRenderDevice = nullptr;
+        mGUISystem = nullptr;
+        mSoundSystem = nullptr;
+        mRenderSystem2D = new RenderSystem2D();
+        mScene = new Scene();
+        mApp = HG_CREATE_OBJECT(appHash, BaseApp);
+        return;
+    }
 
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         HD_LOG_ERROR("Failed to initialize SDL2. Error:\n{}", SDL_GetError());
@@ -392,6 +420,20 @@ void Engine::initialize(const EngineCreateInfo &createInfo, const hd::StringHash
             mCreateInfo.glMajorVer, mCreateInfo.glMinorVer, createInfo.glMajorVer, createInfo.glMinorVer);
     }
 
+    if (createInfo.isRenderThreadEnabled) {
+        // The window context goes to the render thread in run(), the main thread keeps a shared one to create resources.
+        // Buffers, textures and shaders are shared between them, vertex formats (VAOs) are not, so they must be created here
+        SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+        mResourceContext = SDL_GL_CreateContext(mWindow);
+        if (!mResourceContext) {
+            HD_LOG_WARNING("Failed to create shared OpenGL context, render thread is disabled. Error:\n{}", SDL_GetError());
+            mCreateInfo.isRenderThreadEnabled = false;
+        }
+        SDL_GL_MakeCurrent(mWindow, mContext);
+    }
+
+    setVSyncMode(createInfo.vsyncMode);
+
     SDL_Event resizeEvent;
     resizeEvent.type = SDL_WINDOWEVENT;
     resizeEvent.window.event = SDL_WINDOWEVENT_RESIZED;
@@ -416,25 +458,49 @@ void Engine::shutdown() {
     HD_DELETE(mGUISystem);
     HD_DELETE(mRenderSystem2D);
     HD_DELETE(mRenderDevice);
-    SDL_GL_DeleteContext(mContext);
-    SDL_DestroyWindow(mWindow);
-    SDL_Quit();
+    if (mResourceContext) {
+        SDL_GL_DeleteContext(mResourceContext);
+    }
+    if (mWindow) {
+        SDL_GL_DeleteContext(mContext);
+        SDL_DestroyWindow(mWindow);
+        SDL_Quit();
+    }
 }
 
 void Engine::run() {
-    const float UPDATES_COUNT_PER_SEC = 30.0f;
-    const hd::Time UPDATE_TIME = hd::Time::fromMilliseconds(1000.0f / UPDATES_COUNT_PER_SEC);
+    mFixedTimeAccumulator = 0.0f;
+    mInterpolationAlpha = 0.0f;
+
+    auto lastFrameTime = std::chrono::steady_clock::now();
+    auto nextFrameTime = lastFrameTime;
+    Profiler::get().setThreadName("Main");
+    if (isRenderThreadEnabled()) {
+        mStartRenderThread();
+    }
 
-    hd::Time updateTimer, deltaTimer;
     bool isExit = false;
     while (!isExit) {
+        Profiler::get().onFrameBegin();
+        MemoryTracker::get().onFrameBegin();
+        mFrameAllocator.reset();
+        HG_PROFILE_SCOPE("Engine::frame");
+        HG_MEMORY_TAG(MemoryTag::Engine);
+
         SDL_Event event;
         while (SDL_PollEvent(&event)) {
+            HG_PROFILE_SCOPE("Engine::onEvent");
             if (event.type == SDL_QUIT) {
                 isExit = true;
             }
 
             WindowEvent e = sdlEventToWindowEvent(event);
+            if (e.type == WindowEventType::FocusLost) {
+                mIsFocused = false;
+            }
+            else if (e.type == WindowEventType::FocusGained) {
+                mIsFocused = true;
+            }
             mGUISystem->onEvent(e);
             mScene->onEvent(e);
             mApp->onEvent(e);
@@ -444,28 +510,79 @@ void Engine::run() {
             SDL_GetRelativeMouseState(&mCursorDelta.x, &mCursorDelta.y);
         }
 
-        if (hd::Time::getElapsedTime(updateTimer) > UPDATE_TIME) {
+        auto currentFrameTime = std::chrono::steady_clock::now();
+        float dt = std::chrono::duration<float>(currentFrameTime - lastFrameTime).count();
+        lastFrameTime = currentFrameTime;
+
+        // Fixed updates catch up with real time. After a long stall the backlog is dropped instead of
+        // running more and more steps per frame
+        mFixedTimeAccumulator += dt;
+        uint32_t fixedStepsCount = 0;
+        while (mFixedTimeAccumulator >= mFixedDeltaTime && fixedStepsCount < mCreateInfo.maxFixedStepsPerFrame) {
+            HG_PROFILE_SCOPE("Engine::onFixedUpdate");
             mGUISystem->onFixedUpdate();
             mScene->onFixedUpdate();
             mApp->onFixedUpdate();
-            updateTimer = hd::Time::getCurrentTime();
+            mFixedTimeAccumulator -= mFixedDeltaTime;
+            fixedStepsCount++;
+        }
+        if (mFixedTimeAccumulator >= mFixedDeltaTime) {
+            mFixedTimeAccumulator = std::fmod(mFixedTimeAccumulator, mFixedDeltaTime);
         }
+        mInterpolationAlpha = mFixedTimeAccumulator / mFixedDeltaTime;
 
-        float dt = mFPSCounter.getFrameTime()*0.001f;
-        mRenderSystem2D->onUpdate(dt);
+        if (!isRenderThreadEnabled()) {
+            mRenderSystem2D->onUpdate(dt);
+        }
         mGUISystem->onUpdate(dt);
         mScene->onUpdate(dt);
-        mApp->onUpdate(dt);
+        {
+            HG_PROFILE_SCOPE("App::onUpdate");
+            mApp->onUpdate(dt);
+        }
 
-        SDL_GL_SwapWindow(mWindow);
+        if (isRenderThreadEnabled()) {
+            mSubmitFrame();
+        }
+        else {
+            HG_PROFILE_SCOPE("Engine::swapWindow");
+            SDL_GL_SwapWindow(mWindow);
+        }
+
+        float frameRateLimit = mGetFrameRateLimit();
+        if (frameRateLimit > 0.0f) {
+            HG_PROFILE_SCOPE("Engine::frameLimiter");
+            // Sleep is coarse on most systems, so the last couple of milliseconds are spent yielding
+            const auto SPIN_TIME = std::chrono::milliseconds(2);
+            auto framePeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(1.0f / frameRateLimit));
+            auto now = std::chrono::steady_clock::now();
+            nextFrameTime += framePeriod;
+            if (nextFrameTime < now - framePeriod) {
+                nextFrameTime = now; // too far behind, don't try to catch up
+            }
+            if (nextFrameTime - now > SPIN_TIME) {
+                std::this_thread::sleep_for(nextFrameTime - now - SPIN_TIME);
+            }
+            while (std::chrono::steady_clock::now() < nextFrameTime) {
+                std::this_thread::yield();
+            }
+        }
+        else {
+            nextFrameTime = std::chrono::steady_clock::now();
+        }
 
         if (mFPSCounter.update()) {
             uint32_t fps = mFPSCounter.getFps();
             float frameTime = mFPSCounter.getFrameTime();
-            std::string title = fmt::format("{} | FPS: {:0>4} | FrameTime: {}", mCreateInfo.title, fps, frameTime);
+            FrameString title{FrameStlAllocator<char>(mFrameAllocator)};
+            fmt::format_to(std::back_inserter(title), "{} | FPS: {:0>4} | FrameTime: {}", mCreateInfo.title, fps, frameTime);
             SDL_SetWindowTitle(mWindow, title.data());
         }
     }
+
+    if (isRenderThreadEnabled()) {
+        mStopRenderThread();
+    }
 }
 
 void Engine::close() {
@@ -488,6 +605,53 @@ void Engine::setCursorVisible(bool mode) {
     SDL_ShowCursor(mode ? SDL_ENABLE : SDL_DISABLE);
 }
 
+void Engine::setVSyncMode(VSyncMode mode) {
+    mCreateInfo.vsyncMode = mode;
+    if (mRenderThread.joinable()) {
+        mIsVSyncModeChanged = true; // swap interval belongs to the context of the render thread
+    }
+    else {
+        mApplyVSyncMode();
+    }
+}
+
+void Engine::mApplyVSyncMode() {
+    int interval = 0;
+    switch (mCreateInfo.vsyncMode) {
+        case VSyncMode::Disabled: {
+            interval = 0;
+            break;
+        }
+        case VSyncMode::Enabled: {
+            interval = 1;
+            break;
+        }
+        case VSyncMode::Adaptive: {
+            interval = -1;
+            break;
+        }
+    }
+
+    if (SDL_GL_SetSwapInterval(interval) != 0) {
+        if (mCreateInfo.vsyncMode == VSyncMode::Adaptive) {
+            HD_LOG_WARNING("Adaptive vsync is not supported, regular vsync is used instead. Errors: {}", SDL_GetError());
+            mCreateInfo.vsyncMode = VSyncMode::Enabled;
+            mApplyVSyncMode();
+        }
+        else {
+            HD_LOG_WARNING("Failed to set swap interval {}. Errors: {}", interval, SDL_GetError());
+        }
+    }
+}
+
+void Engine::setTargetFrameRate(float frameRate) {
+    mCreateInfo.targetFrameRate = glm::max(frameRate, 0.0f);
+}
+
+void Engine::setBackgroundFrameRate(float frameRate) {
+    mCreateInfo.backgroundFrameRate = glm::max(frameRate, 0.0f);
+}
+
 bool Engine::isKeyDown(KeyCode code) const {
     return SDL_GetKeyboardState(nullptr)[gKeyCodes[static_cast<size_t>(code)]];
 }
@@ -522,6 +686,9 @@ BaseApp *Engine::getApp() {
 }
 
 glm::ivec2 Engine::getWindowSize() const {
+    if (!mWindow) {
+        return mCreateInfo.size;
+    }
     glm::ivec2 v;
     SDL_GetWindowSize(mWindow, &v.x, &v.y);
     return v;
@@ -539,6 +706,38 @@ float Engine::getDeltaTime() const {
     return mFPSCounter.getFrameTime();
 }
 
+float Engine::getFixedDeltaTime() const {
+    return mFixedDeltaTime;
+}
+
+float Engine::getInterpolationAlpha() const {
+    return mInterpolationAlpha;
+}
+
+VSyncMode Engine::getVSyncMode() const {
+    return mCreateInfo.vsyncMode;
+}
+
+float Engine::getTargetFrameRate() const {
+    return mCreateInfo.targetFrameRate;
+}
+
+float Engine::getBackgroundFrameRate() const {
+    return mCreateInfo.backgroundFrameRate;
+}
+
+bool Engine::isFocused() const {
+    return mIsFocused;
+}
+
+bool Engine::isRenderThreadEnabled() const {
+    return mCreateInfo.isRenderThreadEnabled;
+}
+
+bool Engine::isHeadless() const {
+    return mCreateInfo.isHeadless;
+}
+
 const hd::Time &Engine::getTime() const {
     return mTimer;
 }
@@ -577,6 +776,94 @@ Scene &Engine::getScene() {
     return *mScene;
 }
 
+FrameAllocator &Engine::getFrameAllocator() {
+    return mFrameAllocator;
+}
+
+float Engine::mGetFrameRateLimit() const {
+    float frameRate = mCreateInfo.targetFrameRate;
+    if (!mIsFocused && mCreateInfo.backgroundFrameRate > 0.0f) {
+        frameRate = frameRate > 0.0f ? glm::min(frameRate, mCreateInfo.backgroundFrameRate) : mCreateInfo.backgroundFrameRate;
+    }
+    return frameRate;
+}
+
+void Engine::mStartRenderThread() {
+    SDL_GL_MakeCurrent(mWindow, mResourceContext);
+    mIsFrameSubmitted = false;
+    mIsRenderThreadExit = false;
+    mRenderThread = std::thread(&Engine::mRenderThreadFunc, this);
+}
+
+void Engine::mStopRenderThread() {
+    {
+        std::lock_guard<std::mutex> lock(mRenderMutex);
+        mIsRenderThreadExit = true;
+    }
+    mRenderCondition.notify_all();
+    mRenderThread.join();
+
+    // Systems are destroyed on the main thread, so it takes the window context back
+    SDL_GL_MakeCurrent(mWindow, mContext);
+}
+
+void Engine::mSubmitFrame() {
+    HG_PROFILE_SCOPE("Engine::submitFrame");
+    // At most one frame in flight, so recording of the back frames never races with rendering of the front ones
+    {
+        std::unique_lock<std::mutex> lock(mRenderMutex);
+        mRenderCondition.wait(lock, [&] { return !mIsFrameSubmitted; });
+    }
+
+    mRenderSystem2D->mSwapFrames();
+    mGUISystem->mSwapFrames();
+
+    // Resources created on the main thread this frame must be complete before the render thread uses them
+    mFrameFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    {
+        std::lock_guard<std::mutex> lock(mRenderMutex);
+        mIsFrameSubmitted = true;
+    }
+    mRenderCondition.notify_all();
+}
+
+void Engine::mRenderThreadFunc() {
+    SDL_GL_MakeCurrent(mWindow, mContext);
+    Profiler::get().setThreadName("Render");
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mRenderMutex);
+            mRenderCondition.wait(lock, [&] { return mIsFrameSubmitted || mIsRenderThreadExit; });
+            if (!mIsFrameSubmitted) {
+                break;
+            }
+        }
+
+        HG_PROFILE_SCOPE("Engine::renderFrame");
+        GLsync fence = static_cast<GLsync>(mFrameFence);
+        glWaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence);
+
+        if (mIsVSyncModeChanged.exchange(false)) {
+            mApplyVSyncMode();
+        }
+        mRenderSystem2D->mRenderFrontFrame();
+        mGUISystem->mRenderFrontFrame();
+        SDL_GL_SwapWindow(mWindow);
+
+        {
+            std::lock_guard<std::mutex> lock(mRenderMutex);
+            mIsFrameSubmitted = false;
+        }
+        mRenderCondition.notify_all();
+    }
+
+    SDL_GL_MakeCurrent(mWindow, nullptr);
+}
+
 Engine &getEngine() {
     static Engine engine;
     return engine;
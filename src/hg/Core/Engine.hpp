@@ -1,9 +1,14 @@
 #pragma once
 #include "Object.hpp"
 #include "WindowEvent.hpp"
+#include "FrameAllocator.hpp"
 #include "hd/Core/FPSCounter.hpp"
 #include <glm/glm.hpp>
 #include <SDL2/SDL.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 namespace hg {
 
@@ -13,10 +18,21 @@ class GUISystem;
 class SoundSystem;
 class Scene;
 
+enum class VSyncMode {
+    Disabled,
+    Enabled,
+    Adaptive // late frames are swapped immediately, falls back to Enabled if not supported
+};
+
 struct EngineCreateInfo {
     std::string title = "HgEngine Application";
     glm::ivec2 size = glm::ivec2(640, 480);
     bool isFullscreen = false;
+    VSyncMode vsyncMode = VSyncMode::Disabled;
+    float targetFrameRate = 0.0f; // 0 - unlimited
+    float backgroundFrameRate = 15.0f; // used while the window is not focused, 0 - no throttling
+    bool isRenderThreadEnabled = false; // GL submission of frame N overlaps simulation of frame N+1
+    bool isHeadless = false; // no window, GL, GUI and sound. Scene and RenderSystem2D ops still work, used by benchmarks
 
     bool glDebug = true;
     int glMajorVer = 3, glMinorVer = 3;
@@ -26,6 +42,9 @@ struct EngineCreateInfo {
     uint32_t freq = 22050;
     uint32_t chunkSize = 4096;
     bool isStereo = true;
+
+    float fixedUpdateRate = 30.0f;
+    uint32_t maxFixedStepsPerFrame = 5;
 };
 
 class BaseApp : public Object {
@@ -48,6 +67,9 @@ public:
     void setCursorPos(const glm::ivec2 &pos);
     void setCenteredCursorMode(bool mode);
     void setCursorVisible(bool mode);
+    void setVSyncMode(VSyncMode mode);
+    void setTargetFrameRate(float frameRate);
+    void setBackgroundFrameRate(float frameRate);
 
     bool isKeyDown(KeyCode key) const;
     bool isKeyDown(MouseButton btn) const;
@@ -61,6 +83,14 @@ public:
     glm::ivec2 getWindowCenter() const;
     float getWindowAspectRatio() const;
     float getDeltaTime() const;
+    float getFixedDeltaTime() const;
+    float getInterpolationAlpha() const;
+    VSyncMode getVSyncMode() const;
+    float getTargetFrameRate() const;
+    float getBackgroundFrameRate() const;
+    bool isFocused() const;
+    bool isRenderThreadEnabled() const;
+    bool isHeadless() const;
     const hd::Time &getTime() const;
     glm::ivec2 getCursorPos() const;
     const glm::ivec2 &getCursorDelta() const;
@@ -71,16 +101,38 @@ public:
     GUISystem &getGUISystem();
     SoundSystem &getSoundSystem();
     Scene &getScene();
+    FrameAllocator &getFrameAllocator();
 
 private:
+    float mGetFrameRateLimit() const;
+    void mApplyVSyncMode();
+    void mStartRenderThread();
+    void mStopRenderThread();
+    void mSubmitFrame();
+    void mRenderThreadFunc();
+
     EngineCreateInfo mCreateInfo;
     SDL_Window *mWindow;
     SDL_GLContext mContext;
+    SDL_GLContext mResourceContext;
     hd::FPSCounter mFPSCounter;
     BaseApp *mApp;
     hd::Time mTimer;
     glm::ivec2 mCursorDelta;
     bool mIsCenteredCursorMode;
+    float mFixedDeltaTime;
+    float mFixedTimeAccumulator;
+    float mInterpolationAlpha;
+    bool mIsFocused;
+    FrameAllocator mFrameAllocator;
+
+    std::thread mRenderThread;
+    std::mutex mRenderMutex;
+    std::condition_variable mRenderCondition;
+    bool mIsFrameSubmitted;
+    bool mIsRenderThreadExit;
+    void *mFrameFence;
+    std::atomic<bool> mIsVSyncModeChanged;
 
     RenderDevice *mRenderDevice;
     RenderSystem2D *mRenderSystem2D;
@@ -0,0 +1,67 @@
+#include "FrameAllocator.hpp"
+#include "hd/Core/Log.hpp"
+#include <algorithm>
+
+namespace hg {
+
+FrameAllocator::FrameAllocator(size_t blockSize) : mBlockSize(blockSize) {
+}
+
+void *FrameAllocator::allocate(size_t size, size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        HD_LOG_FATAL("Invalid frame allocation alignment {}", alignment);
+    }
+
+    if (!mBlocks.empty()) {
+        Block &block = mBlocks.back();
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        uintptr_t aligned = (base + mOffset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+        size_t offset = static_cast<size_t>(aligned - base);
+        if (offset + size <= block.size) {
+            mUsedBytes += offset + size - mOffset;
+            mOffset = offset + size;
+            mPeakUsedBytes = std::max(mPeakUsedBytes, mUsedBytes);
+            return block.data.get() + offset;
+        }
+    }
+
+    mAllocateBlock(size + alignment);
+    return allocate(size, alignment);
+}
+
+void FrameAllocator::reset() {
+    // A frame that overflowed into several blocks is merged into one, so following frames don't chase pointers
+    if (mBlocks.size() > 1) {
+        size_t capacity = getCapacity();
+        mBlocks.clear();
+        mAllocateBlock(capacity);
+    }
+    mOffset = 0;
+    mUsedBytes = 0;
+}
+
+size_t FrameAllocator::getUsedBytes() const {
+    return mUsedBytes;
+}
+
+size_t FrameAllocator::getPeakUsedBytes() const {
+    return mPeakUsedBytes;
+}
+
+size_t FrameAllocator::getCapacity() const {
+    size_t capacity = 0;
+    for (const Block &block : mBlocks) {
+        capacity += block.size;
+    }
+    return capacity;
+}
+
+void FrameAllocator::mAllocateBlock(size_t minSize) {
+    Block block;
+    block.size = std::max(mBlockSize, minSize);
+    block.data.reset(new uint8_t[block.size]);
+    mBlocks.push_back(std::move(block));
+    mOffset = 0;
+}
+
+}
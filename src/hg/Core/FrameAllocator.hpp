@@ -0,0 +1,83 @@
+#pragma once
+#include "hd/Core/Common.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <string>
+
+namespace hg {
+
+// Linear arena for data that lives no longer than one frame. Allocation is a pointer bump, deallocation
+// is a no-op, everything is released at once by reset(). Not thread-safe, the engine's arena belongs to the main thread
+class FrameAllocator : public hd::Noncopyable {
+public:
+    explicit FrameAllocator(size_t blockSize = 256*1024);
+
+    void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    void reset();
+
+    template<typename T>
+    T *allocate(size_t count) {
+        return static_cast<T*>(allocate(count*sizeof(T), alignof(T)));
+    }
+
+    size_t getUsedBytes() const;
+    size_t getPeakUsedBytes() const;
+    size_t getCapacity() const;
+
+private:
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+    };
+
+    void mAllocateBlock(size_t minSize);
+
+    size_t mBlockSize;
+    std::vector<Block> mBlocks;
+    size_t mOffset = 0;
+    size_t mUsedBytes = 0;
+    size_t mPeakUsedBytes = 0;
+};
+
+template<typename T>
+class FrameStlAllocator {
+public:
+    using value_type = T;
+
+    explicit FrameStlAllocator(FrameAllocator &allocator) : mAllocator(&allocator) {}
+
+    template<typename U>
+    FrameStlAllocator(const FrameStlAllocator<U> &rhs) : mAllocator(rhs.getAllocator()) {}
+
+    T *allocate(size_t count) {
+        return mAllocator->allocate<T>(count);
+    }
+
+    void deallocate(T*, size_t) {
+    }
+
+    FrameAllocator *getAllocator() const {
+        return mAllocator;
+    }
+
+    template<typename U>
+    bool operator==(const FrameStlAllocator<U> &rhs) const {
+        return mAllocator == rhs.getAllocator();
+    }
+
+    template<typename U>
+    bool operator!=(const FrameStlAllocator<U> &rhs) const {
+        return mAllocator != rhs.getAllocator();
+    }
+
+private:
+    FrameAllocator *mAllocator;
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameStlAllocator<T>>;
+using FrameString = std::basic_string<char, std::char_traits<char>, FrameStlAllocator<char>>;
+
+}
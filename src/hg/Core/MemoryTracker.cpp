@@ -0,0 +1,268 @@
+#include "MemoryTracker.hpp"
+#include "../../imgui/imgui.h"
+#include "../../nameof/nameof.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace hg {
+
+static const size_t TAGS_COUNT = static_cast<size_t>(MemoryTag::Count);
+
+// Plain zero-initialized globals, so allocations made during static initialization are counted safely
+struct TagCounters {
+    std::atomic<int64_t> currentBytes;
+    std::atomic<int64_t> peakBytes;
+    std::atomic<int64_t> currentAllocs;
+    std::atomic<uint64_t> totalAllocs;
+    std::atomic<uint64_t> frameAllocs;
+    std::atomic<uint64_t> frameBytes;
+};
+
+static TagCounters gCounters[TAGS_COUNT];
+static thread_local MemoryTag gThreadTag = MemoryTag::Untagged;
+
+#ifdef HG_MEMORY_TRACKING
+
+struct alignas(16) AllocationHeader {
+    size_t size;
+    MemoryTag tag;
+};
+
+static void *trackedAllocate(size_t size) {
+    AllocationHeader *header = static_cast<AllocationHeader*>(std::malloc(sizeof(AllocationHeader) + size));
+    if (!header) {
+        return nullptr;
+    }
+    header->size = size;
+    header->tag = gThreadTag;
+
+    TagCounters &counters = gCounters[static_cast<size_t>(header->tag)];
+    int64_t currentBytes = counters.currentBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) + static_cast<int64_t>(size);
+    int64_t peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+    while (currentBytes > peakBytes && !counters.peakBytes.compare_exchange_weak(peakBytes, currentBytes, std::memory_order_relaxed)) {
+    }
+    counters.currentAllocs.fetch_add(1, std::memory_order_relaxed);
+    counters.totalAllocs.fetch_add(1, std::memory_order_relaxed);
+    counters.frameAllocs.fetch_add(1, std::memory_order_relaxed);
+    counters.frameBytes.fetch_add(size, std::memory_order_relaxed);
+    return header + 1;
+}
+
+static void trackedFree(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    // Freed memory is accounted to the tag it was allocated with
+    AllocationHeader *header = static_cast<AllocationHeader*>(ptr) - 1;
+    TagCounters &counters = gCounters[static_cast<size_t>(header->tag)];
+    counters.currentBytes.fetch_sub(static_cast<int64_t>(header->size), std::memory_order_relaxed);
+    counters.currentAllocs.fetch_sub(1, std::memory_order_relaxed);
+    std::free(header);
+}
+
+static void *trackedAllocateOrThrow(size_t size) {
+    void *ptr = trackedAllocate(size);
+    while (!ptr) {
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+        ptr = trackedAllocate(size);
+    }
+    return ptr;
+}
+
+#endif
+
+MemoryTracker &MemoryTracker::get() {
+    static MemoryTracker *tracker = new MemoryTracker();
+    return *tracker;
+}
+
+bool MemoryTracker::isEnabled() {
+#ifdef HG_MEMORY_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void MemoryTracker::onFrameBegin() {
+    for (size_t i = 0; i < TAGS_COUNT; i++) {
+        MemoryStats &stats = mFrameStats[i];
+        stats.frameAllocs = gCounters[i].frameAllocs.exchange(0, std::memory_order_relaxed);
+        stats.frameBytes = gCounters[i].frameBytes.exchange(0, std::memory_order_relaxed);
+        stats.peakFrameAllocs = std::max(stats.peakFrameAllocs, stats.frameAllocs);
+        stats.peakFrameBytes = std::max(stats.peakFrameBytes, stats.frameBytes);
+    }
+}
+
+void MemoryTracker::onGUI() {
+    if (!ImGui::Begin("Memory", &mIsWindowVisible)) {
+        ImGui::End();
+        return;
+    }
+
+    if (!isEnabled()) {
+        ImGui::Text("Memory tracking is disabled. Build the engine with HG_MEMORY_TRACKING");
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::Button("Reset peaks")) {
+        resetPeaks();
+    }
+
+    ImGui::Columns(7, "MemoryStats");
+    ImGui::Text("Tag");
+    ImGui::NextColumn();
+    ImGui::Text("Current, KB");
+    ImGui::NextColumn();
+    ImGui::Text("Peak, KB");
+    ImGui::NextColumn();
+    ImGui::Text("Blocks");
+    ImGui::NextColumn();
+    ImGui::Text("Frame allocs");
+    ImGui::NextColumn();
+    ImGui::Text("Frame, KB");
+    ImGui::NextColumn();
+    ImGui::Text("Peak frame allocs");
+    ImGui::NextColumn();
+    ImGui::Separator();
+
+    auto drawRow = [](const char *name, const MemoryStats &stats) {
+        ImGui::Text("%s", name);
+        ImGui::NextColumn();
+        ImGui::Text("%.1f", stats.currentBytes / 1024.0);
+        ImGui::NextColumn();
+        ImGui::Text("%.1f", stats.peakBytes / 1024.0);
+        ImGui::NextColumn();
+        ImGui::Text("%lld", static_cast<long long>(stats.currentAllocs));
+        ImGui::NextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(stats.frameAllocs));
+        ImGui::NextColumn();
+        ImGui::Text("%.1f", stats.frameBytes / 1024.0);
+        ImGui::NextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(stats.peakFrameAllocs));
+        ImGui::NextColumn();
+    };
+
+    for (size_t i = 0; i < TAGS_COUNT; i++) {
+        MemoryTag tag = static_cast<MemoryTag>(i);
+        std::string name = std::string(NAMEOF_ENUM(tag));
+        drawRow(name.c_str(), getStats(tag));
+    }
+    ImGui::Separator();
+    drawRow("Total", getTotalStats());
+    ImGui::Columns(1);
+
+    ImGui::End();
+}
+
+void MemoryTracker::resetPeaks() {
+    for (size_t i = 0; i < TAGS_COUNT; i++) {
+        gCounters[i].peakBytes.store(gCounters[i].currentBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        mFrameStats[i].peakFrameAllocs = mFrameStats[i].frameAllocs;
+        mFrameStats[i].peakFrameBytes = mFrameStats[i].frameBytes;
+    }
+}
+
+void MemoryTracker::setWindowVisible(bool visible) {
+    mIsWindowVisible = visible;
+}
+
+MemoryStats MemoryTracker::getStats(MemoryTag tag) const {
+    const size_t index = static_cast<size_t>(tag);
+    MemoryStats stats = mFrameStats[index];
+    stats.currentBytes = gCounters[index].currentBytes.load(std::memory_order_relaxed);
+    stats.peakBytes = gCounters[index].peakBytes.load(std::memory_order_relaxed);
+    stats.currentAllocs = gCounters[index].currentAllocs.load(std::memory_order_relaxed);
+    stats.totalAllocs = gCounters[index].totalAllocs.load(std::memory_order_relaxed);
+    return stats;
+}
+
+MemoryStats MemoryTracker::getTotalStats() const {
+    // Peaks of different tags are reached at different moments, so the total peak is an upper bound
+    MemoryStats total;
+    for (size_t i = 0; i < TAGS_COUNT; i++) {
+        MemoryStats stats = getStats(static_cast<MemoryTag>(i));
+        total.currentBytes += stats.currentBytes;
+        total.peakBytes += stats.peakBytes;
+        total.currentAllocs += stats.currentAllocs;
+        total.totalAllocs += stats.totalAllocs;
+        total.frameAllocs += stats.frameAllocs;
+        total.frameBytes += stats.frameBytes;
+        total.peakFrameAllocs += stats.peakFrameAllocs;
+        total.peakFrameBytes += stats.peakFrameBytes;
+    }
+    return total;
+}
+
+bool MemoryTracker::isWindowVisible() const {
+    return mIsWindowVisible;
+}
+
+MemoryTag MemoryTracker::getThreadTag() {
+    return gThreadTag;
+}
+
+void MemoryTracker::setThreadTag(MemoryTag tag) {
+    gThreadTag = tag;
+}
+
+MemoryTagScope::MemoryTagScope(MemoryTag tag) : mPrevTag(gThreadTag) {
+    gThreadTag = tag;
+}
+
+MemoryTagScope::~MemoryTagScope() {
+    gThreadTag = mPrevTag;
+}
+
+}
+
+#ifdef HG_MEMORY_TRACKING
+
+void *operator new(size_t size) {
+    return hg::trackedAllocateOrThrow(size);
+}
+
+void *operator new[](size_t size) {
+    return hg::trackedAllocateOrThrow(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t&) noexcept {
+    return hg::trackedAllocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return hg::trackedAllocate(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    hg::trackedFree(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    hg::trackedFree(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    hg::trackedFree(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    hg::trackedFree(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t&) noexcept {
+    hg::trackedFree(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t&) noexcept {
+    hg::trackedFree(ptr);
+}
+
+#endif
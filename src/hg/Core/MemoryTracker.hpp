@@ -0,0 +1,73 @@
+#pragma once
+#include "hd/Core/Common.hpp"
+#include <cstdint>
+#include <cstddef>
+
+// Allocations are counted only when the engine is built with HG_MEMORY_TRACKING (replaces global operator new/delete).
+// Without it the API is still available and reports zeros
+#define HG_MEMORY_TAG_CONCAT_IMPL(a, b) a##b
+#define HG_MEMORY_TAG_CONCAT(a, b) HG_MEMORY_TAG_CONCAT_IMPL(a, b)
+#define HG_MEMORY_TAG(tag) hg::MemoryTagScope HG_MEMORY_TAG_CONCAT(hgMemoryTag, __LINE__)(tag)
+
+namespace hg {
+
+enum class MemoryTag : uint32_t {
+    Untagged,
+    Engine,
+    Scene,
+    Physics,
+    Render,
+    GUI,
+    Sound,
+    Resources,
+    Count
+};
+
+struct MemoryStats {
+    int64_t currentBytes = 0;
+    int64_t peakBytes = 0;
+    int64_t currentAllocs = 0;
+    uint64_t totalAllocs = 0;
+    uint64_t frameAllocs = 0; // during the last finished frame
+    uint64_t frameBytes = 0;
+    uint64_t peakFrameAllocs = 0;
+    uint64_t peakFrameBytes = 0;
+};
+
+class MemoryTracker : public hd::Noncopyable {
+public:
+    static MemoryTracker &get();
+    static bool isEnabled();
+
+    // Closes per-frame counters. Called by Engine at the start of every frame
+    void onFrameBegin();
+    // Draws the statistics window. Called by GUISystem when the window is visible
+    void onGUI();
+
+    void resetPeaks();
+    void setWindowVisible(bool visible);
+
+    MemoryStats getStats(MemoryTag tag) const;
+    MemoryStats getTotalStats() const;
+    bool isWindowVisible() const;
+
+    static MemoryTag getThreadTag();
+    static void setThreadTag(MemoryTag tag);
+
+private:
+    MemoryTracker() = default;
+
+    MemoryStats mFrameStats[static_cast<size_t>(MemoryTag::Count)];
+    bool mIsWindowVisible = false;
+};
+
+class MemoryTagScope {
+public:
+    explicit MemoryTagScope(MemoryTag tag);
+    ~MemoryTagScope();
+
+private:
+    MemoryTag mPrevTag;
+};
+
+}
@@ -2,11 +2,13 @@
 #include "hd/Core/Common.hpp"
 #include "hd/Core/Log.hpp"
 #include "hd/Core/StringHash.hpp"
+#include "PoolAllocator.hpp"
 #include "../../nameof/nameof.hpp"
-#include <functional>
+#include <unordered_map>
 
 #define HG_CREATE_OBJECT(nameOrHash, type) hg::Factory::get().createObject(nameOrHash)->as<type>()
 #define HG_OBJECT(typeName, baseTypeName) \
+    HG_POOLED_OBJECT(typeName) \
     public: \
         using ClassName = typeName; \
         using BaseClassName = baseTypeName; \
@@ -89,7 +91,7 @@ public:
     template<typename T>
     void registerObject() {
         if (!mCreateFunctions.count(T::getTypeHashStatic())) {
-            mCreateFunctions.insert(std::make_pair(T::getTypeHashStatic(), []() -> Object* { return new T(); }));
+            mCreateFunctions.insert(std::make_pair(T::getTypeHashStatic(), &mCreate<T>));
             HD_LOG_INFO("Object '{}' registered at factory", T::getTypeNameStatic());
         }
     }
@@ -98,7 +100,14 @@ public:
     Object *createObject(const hd::StringHash &typeHash);
 
 private:
-    std::unordered_map<hd::StringHash, std::function<Object*()>> mCreateFunctions;
+    using CreateFunction = Object*(*)();
+
+    template<typename T>
+    static Object *mCreate() {
+        return new T();
+    }
+
+    std::unordered_map<hd::StringHash, CreateFunction> mCreateFunctions;
 };
 
 inline Factory &getFactory() {
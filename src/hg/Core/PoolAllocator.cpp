@@ -0,0 +1,102 @@
+#include "PoolAllocator.hpp"
+#include "hd/Core/Log.hpp"
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+namespace hg {
+
+static const size_t CHUNK_SIZE = 64*1024;
+static const size_t MIN_BLOCKS_PER_CHUNK = 16;
+
+PoolAllocator::PoolAllocator(size_t blockSize) {
+    const size_t alignment = alignof(BlockHeader);
+    mBlockSize = blockSize;
+    mBlockStride = sizeof(BlockHeader) + (blockSize + alignment - 1) / alignment*alignment;
+    mBlocksPerChunk = std::max(CHUNK_SIZE / mBlockStride, MIN_BLOCKS_PER_CHUNK);
+}
+
+PoolAllocator::~PoolAllocator() {
+    if (mUsedBlocksCount != 0) {
+        HD_LOG_WARNING("Pool with block size {} destroyed with {} blocks still in use", mBlockSize, mUsedBlocksCount);
+    }
+}
+
+void *PoolAllocator::allocate() {
+    if (!mFreeList) {
+        mAllocateChunk();
+    }
+
+    BlockHeader *header = mFreeList;
+    mFreeList = *reinterpret_cast<BlockHeader**>(header + 1);
+    mUsedBlocksCount++;
+    return header + 1;
+}
+
+void PoolAllocator::deallocate(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    BlockHeader *header = mGetHeader(ptr);
+    if (header->pool != this) {
+        HD_LOG_FATAL("Failed to deallocate block. It was allocated by another pool");
+    }
+    header->generation++;
+    *reinterpret_cast<BlockHeader**>(ptr) = mFreeList;
+    mFreeList = header;
+    mUsedBlocksCount--;
+}
+
+size_t PoolAllocator::getBlockSize() const {
+    return mBlockSize;
+}
+
+size_t PoolAllocator::getUsedBlocksCount() const {
+    return mUsedBlocksCount;
+}
+
+size_t PoolAllocator::getReservedBlocksCount() const {
+    return mChunks.size()*mBlocksPerChunk;
+}
+
+uint32_t PoolAllocator::getGeneration(const void *ptr) {
+    return mGetHeader(ptr)->generation;
+}
+
+void PoolAllocator::free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    mGetHeader(ptr)->pool->deallocate(ptr);
+}
+
+PoolAllocator &PoolAllocator::getForSize(size_t size) {
+    static std::mutex *mutex = new std::mutex();
+    static std::unordered_map<size_t, PoolAllocator*> *pools = new std::unordered_map<size_t, PoolAllocator*>();
+    std::lock_guard<std::mutex> lock(*mutex);
+    PoolAllocator *&pool = (*pools)[size];
+    if (!pool) {
+        pool = new PoolAllocator(size);
+    }
+    return *pool;
+}
+
+PoolAllocator::BlockHeader *PoolAllocator::mGetHeader(const void *ptr) {
+    return const_cast<BlockHeader*>(static_cast<const BlockHeader*>(ptr) - 1);
+}
+
+void PoolAllocator::mAllocateChunk() {
+    std::unique_ptr<uint8_t[]> chunk(new uint8_t[mBlocksPerChunk*mBlockStride]);
+    for (size_t i = mBlocksPerChunk; i > 0; i--) {
+        BlockHeader *header = reinterpret_cast<BlockHeader*>(chunk.get() + (i - 1)*mBlockStride);
+        header->pool = this;
+        header->generation = 0;
+        *reinterpret_cast<BlockHeader**>(header + 1) = mFreeList;
+        mFreeList = header;
+    }
+    mChunks.push_back(std::move(chunk));
+}
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include "hd/Core/Common.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace hg {
+
+class PoolAllocator : public hd::Noncopyable {
+public:
+    explicit PoolAllocator(size_t blockSize);
+    ~PoolAllocator();
+
+    void *allocate();
+    void deallocate(void *ptr);
+
+    size_t getBlockSize() const;
+    size_t getUsedBlocksCount() const;
+    size_t getReservedBlocksCount() const;
+
+    // Every block is prefixed with a header holding owning pool and generation.
+    // Generation is incremented when a block is freed, so stale handles can be detected.
+    // Blocks never go back to the heap, so the header of a freed block can always be read
+    static uint32_t getGeneration(const void *ptr);
+    static void free(void *ptr);
+
+    // Shared pool for blocks of the given size. Never destroyed, so objects deleted during static destruction
+    // still have a valid pool
+    static PoolAllocator &getForSize(size_t size);
+
+    template<typename T>
+    static PoolAllocator &getFor() {
+        static PoolAllocator *pool = &getForSize(sizeof(T));
+        return *pool;
+    }
+
+    template<typename T>
+    static void *allocateFor(size_t size) {
+        // Derived types without own pool have different size and get the pool of their size
+        return size == sizeof(T) ? getFor<T>().allocate() : getForSize(size).allocate();
+    }
+
+private:
+    struct alignas(16) BlockHeader {
+        PoolAllocator *pool;
+        uint32_t generation;
+    };
+
+    static BlockHeader *mGetHeader(const void *ptr);
+    void mAllocateChunk();
+
+    size_t mBlockSize;
+    size_t mBlockStride;
+    size_t mBlocksPerChunk;
+    size_t mUsedBlocksCount = 0;
+    std::vector<std::unique_ptr<uint8_t[]>> mChunks;
+    BlockHeader *mFreeList = nullptr;
+};
+
+template<typename T>
+class PoolHandle {
+public:
+    PoolHandle() = default;
+    explicit PoolHandle(T *ptr) : mPtr(ptr), mGeneration(ptr ? PoolAllocator::getGeneration(ptr) : 0) {}
+
+    T *get() const {
+        return (mPtr && PoolAllocator::getGeneration(mPtr) == mGeneration) ? mPtr : nullptr;
+    }
+
+    bool isValid() const {
+        return get() != nullptr;
+    }
+
+    void reset() {
+        mPtr = nullptr;
+        mGeneration = 0;
+    }
+
+    T *operator->() const {
+        return get();
+    }
+
+    explicit operator bool() const {
+        return isValid();
+    }
+
+    bool operator==(const PoolHandle &rhs) const {
+        return mPtr == rhs.mPtr && mGeneration == rhs.mGeneration;
+    }
+
+    bool operator!=(const PoolHandle &rhs) const {
+        return !(*this == rhs);
+    }
+
+private:
+    T *mPtr = nullptr;
+    uint32_t mGeneration = 0;
+};
+
+}
+
+#define HG_POOLED_OBJECT(typeName) \
+    public: \
+        static void *operator new(size_t size) { return hg::PoolAllocator::allocateFor<typeName>(size); } \
+        static void operator delete(void *ptr) { hg::PoolAllocator::free(ptr); }
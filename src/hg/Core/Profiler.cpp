@@ -0,0 +1,270 @@
+#include "Profiler.hpp"
+#include "hd/Core/Log.hpp"
+#include "hd/Core/JSON.hpp"
+#include "../../imgui/imgui.h"
+#include <algorithm>
+#include <cfloat>
+#include <fstream>
+
+namespace hg {
+
+Profiler &Profiler::get() {
+    // Never destroyed, so scopes closed during static destruction still have a valid profiler
+    static Profiler *profiler = new Profiler();
+    return *profiler;
+}
+
+void Profiler::onFrameBegin() {
+    uint64_t now = mGetTime();
+    mCurrentFrame.end = now;
+
+    {
+        std::lock_guard<std::mutex> lock(mThreadBuffersMutex);
+        for (auto &buffer : mThreadBuffers) {
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+            for (uint64_t i = tail; i < head; i++) {
+                mCurrentFrame.zones.push_back(buffer->zones[i % RING_SIZE]);
+            }
+            buffer->tail.store(head, std::memory_order_release);
+        }
+    }
+
+    if (!mIsPaused && mCurrentFrame.begin != 0 && !mCurrentFrame.zones.empty()) {
+        if (mFrames.size() < FRAMES_HISTORY_SIZE) {
+            mFrames.push_back(ProfileFrame());
+        }
+        std::swap(mFrames[mNextFrame], mCurrentFrame);
+        mNextFrame = (mNextFrame + 1) % FRAMES_HISTORY_SIZE;
+    }
+    mCurrentFrame.zones.clear();
+    mCurrentFrame.begin = now;
+}
+
+void Profiler::onGUI() {
+    if (!ImGui::Begin("Profiler", &mIsWindowVisible)) {
+        ImGui::End();
+        return;
+    }
+
+    bool isEnabled = this->isEnabled();
+    if (ImGui::Checkbox("Enabled", &isEnabled)) {
+        setEnabled(isEnabled);
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("Pause", &mIsPaused);
+    ImGui::SameLine();
+    if (ImGui::Button("Export trace")) {
+        exportChromeTrace("profile.json");
+    }
+    ImGui::SameLine();
+    ImGui::Text("Dropped zones: %llu", static_cast<unsigned long long>(getDroppedZonesCount()));
+
+    if (mFrames.empty()) {
+        ImGui::End();
+        return;
+    }
+
+    // Frames in chronological order
+    const size_t framesCount = mFrames.size();
+    const size_t oldestFrame = framesCount < FRAMES_HISTORY_SIZE ? 0 : mNextFrame;
+    mFrameTimes.resize(framesCount);
+    for (size_t i = 0; i < framesCount; i++) {
+        const ProfileFrame &frame = mFrames[(oldestFrame + i) % framesCount];
+        mFrameTimes[i] = static_cast<float>(frame.end - frame.begin)*1e-6f;
+    }
+
+    ImGui::PlotHistogram("##FrameTimes", mFrameTimes.data(), static_cast<int>(framesCount), 0, "Frame time, ms", 0.0f, FLT_MAX, ImVec2(ImGui::GetContentRegionAvail().x, 60.0f));
+    if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(0)) {
+        float x = (ImGui::GetMousePos().x - ImGui::GetItemRectMin().x) / ImGui::GetItemRectSize().x;
+        mSelectedFrame = static_cast<int>(x*framesCount);
+        mIsPaused = true;
+    }
+    if (mSelectedFrame < 0 || mSelectedFrame >= static_cast<int>(framesCount) || !mIsPaused) {
+        mSelectedFrame = static_cast<int>(framesCount) - 1;
+    }
+    ImGui::SliderInt("Frame", &mSelectedFrame, 0, static_cast<int>(framesCount) - 1);
+
+    const ProfileFrame &frame = mFrames[(oldestFrame + mSelectedFrame) % framesCount];
+    const double duration = static_cast<double>(std::max<uint64_t>(frame.end - frame.begin, 1));
+    ImGui::Text("%.3f ms, %zu zones", (frame.end - frame.begin)*1e-6, frame.zones.size());
+
+    // One lane per thread, one row per nesting level
+    std::vector<std::string> threadNames;
+    {
+        std::lock_guard<std::mutex> lock(mThreadBuffersMutex);
+        for (const auto &buffer : mThreadBuffers) {
+            threadNames.push_back(buffer->name);
+        }
+    }
+    std::vector<uint32_t> laneRows(threadNames.size(), 0);
+    for (const auto &zone : frame.zones) {
+        laneRows[zone.thread] = std::max(laneRows[zone.thread], zone.depth + 1);
+    }
+    const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+    std::vector<float> laneOffsets(threadNames.size(), 0.0f);
+    float totalHeight = 0.0f;
+    for (size_t i = 0; i < laneOffsets.size(); i++) {
+        laneOffsets[i] = totalHeight;
+        totalHeight += laneRows[i] > 0 ? laneRows[i]*rowHeight + rowHeight*0.5f : 0.0f;
+    }
+
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+    const ImVec2 mousePos = ImGui::GetMousePos();
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    drawList->PushClipRect(origin, ImVec2(origin.x + width, origin.y + totalHeight), true);
+    for (const auto &zone : frame.zones) {
+        double begin = zone.begin > frame.begin ? static_cast<double>(zone.begin - frame.begin) : 0.0;
+        double end = zone.end > frame.begin ? static_cast<double>(zone.end - frame.begin) : 0.0;
+        ImVec2 min = ImVec2(origin.x + static_cast<float>(begin / duration)*width, origin.y + laneOffsets[zone.thread] + zone.depth*rowHeight);
+        ImVec2 max = ImVec2(std::max(origin.x + static_cast<float>(end / duration)*width, min.x + 1.0f), min.y + rowHeight - 1.0f);
+
+        float hue = static_cast<float>(std::hash<const void*>()(zone.name) % 360) / 360.0f;
+        drawList->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.7f));
+        if (max.x - min.x > ImGui::CalcTextSize(zone.name).x + 4.0f) {
+            drawList->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32_WHITE, zone.name);
+        }
+
+        if (ImGui::IsWindowHovered() && mousePos.x >= min.x && mousePos.x < max.x && mousePos.y >= min.y && mousePos.y < max.y) {
+            ImGui::BeginTooltip();
+            ImGui::Text("%s", zone.name);
+            ImGui::Text("%.3f ms", (zone.end - zone.begin)*1e-6);
+            ImGui::Text("Thread: %s", threadNames[zone.thread].c_str());
+            ImGui::EndTooltip();
+        }
+    }
+    drawList->PopClipRect();
+    ImGui::Dummy(ImVec2(width, totalHeight));
+
+    ImGui::End();
+}
+
+bool Profiler::exportChromeTrace(const std::string &path) const {
+    hd::JSON events = hd::JSON::array();
+    {
+        std::lock_guard<std::mutex> lock(mThreadBuffersMutex);
+        for (const auto &buffer : mThreadBuffers) {
+            hd::JSON event;
+            event["name"] = "thread_name";
+            event["ph"] = "M";
+            event["pid"] = 0;
+            event["tid"] = buffer->index;
+            event["args"]["name"] = buffer->name;
+            events.push_back(event);
+        }
+    }
+
+    const size_t framesCount = mFrames.size();
+    const size_t oldestFrame = framesCount < FRAMES_HISTORY_SIZE ? 0 : mNextFrame;
+    for (size_t i = 0; i < framesCount; i++) {
+        for (const auto &zone : mFrames[(oldestFrame + i) % framesCount].zones) {
+            hd::JSON event;
+            event["name"] = zone.name;
+            event["ph"] = "X";
+            event["ts"] = zone.begin*1e-3;
+            event["dur"] = (zone.end - zone.begin)*1e-3;
+            event["pid"] = 0;
+            event["tid"] = zone.thread;
+            events.push_back(event);
+        }
+    }
+
+    hd::JSON data;
+    data["traceEvents"] = events;
+    data["displayTimeUnit"] = "ms";
+
+    // std::ofstream instead of hd::FileStream, which doesn't report failed opens or writes
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    file << data.dump() << '\n';
+    file.close();
+    if (!file) {
+        HD_LOG_ERROR("Failed to export profiler trace to '{}'", path);
+        return false;
+    }
+    HD_LOG_INFO("Profiler trace with {} events exported to '{}'", events.size(), path);
+    return true;
+}
+
+void Profiler::setEnabled(bool enabled) {
+    mIsEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::setWindowVisible(bool visible) {
+    mIsWindowVisible = visible;
+}
+
+void Profiler::setThreadName(const std::string &name) {
+    ThreadBuffer &buffer = mGetThreadBuffer();
+    std::lock_guard<std::mutex> lock(mThreadBuffersMutex);
+    buffer.name = name;
+}
+
+bool Profiler::isEnabled() const {
+    return mIsEnabled.load(std::memory_order_relaxed);
+}
+
+bool Profiler::isWindowVisible() const {
+    return mIsWindowVisible;
+}
+
+uint64_t Profiler::getDroppedZonesCount() const {
+    return mDroppedZonesCount.load(std::memory_order_relaxed);
+}
+
+Profiler::Profiler() : mStartTime(std::chrono::steady_clock::now()), mIsEnabled(false), mDroppedZonesCount(0) {
+}
+
+uint64_t Profiler::mGetTime() const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - mStartTime).count());
+}
+
+Profiler::ThreadBuffer &Profiler::mGetThreadBuffer() {
+    // Buffers are owned by the profiler and outlive their threads
+    thread_local ThreadBuffer *threadBuffer = nullptr;
+    if (!threadBuffer) {
+        std::lock_guard<std::mutex> lock(mThreadBuffersMutex);
+        mThreadBuffers.push_back(std::make_unique<ThreadBuffer>());
+        threadBuffer = mThreadBuffers.back().get();
+        threadBuffer->index = static_cast<uint32_t>(mThreadBuffers.size() - 1);
+        threadBuffer->name = "Thread " + std::to_string(threadBuffer->index);
+    }
+    return *threadBuffer;
+}
+
+void Profiler::mPushZone(ThreadBuffer &buffer, const ProfileZone &zone) {
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    uint64_t tail = buffer.tail.load(std::memory_order_acquire);
+    if (head - tail >= RING_SIZE) {
+        mDroppedZonesCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.zones[head % RING_SIZE] = zone;
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+ProfileScope::ProfileScope(const char *name) : mName(name), mBegin(0), mDepth(0), mIsActive(Profiler::get().isEnabled()) {
+    if (mIsActive) {
+        Profiler &profiler = Profiler::get();
+        mDepth = profiler.mGetThreadBuffer().depth++;
+        mBegin = profiler.mGetTime();
+    }
+}
+
+ProfileScope::~ProfileScope() {
+    if (mIsActive) {
+        Profiler &profiler = Profiler::get();
+        Profiler::ThreadBuffer &buffer = profiler.mGetThreadBuffer();
+        buffer.depth--;
+
+        ProfileZone zone;
+        zone.name = mName;
+        zone.begin = mBegin;
+        zone.end = profiler.mGetTime();
+        zone.depth = mDepth;
+        zone.thread = buffer.index;
+        profiler.mPushZone(buffer, zone);
+    }
+}
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "hd/Core/Common.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef HG_DISABLE_PROFILER
+#define HG_PROFILE_CONCAT_IMPL(a, b) a##b
+#define HG_PROFILE_CONCAT(a, b) HG_PROFILE_CONCAT_IMPL(a, b)
+// name must be a string literal or have static storage duration
+#define HG_PROFILE_SCOPE(name) hg::ProfileScope HG_PROFILE_CONCAT(hgProfileScope, __LINE__)(name)
+#else
+#define HG_PROFILE_SCOPE(name)
+#endif
+
+namespace hg {
+
+struct ProfileZone {
+    const char *name = nullptr;
+    uint64_t begin = 0; // nanoseconds since profiler creation
+    uint64_t end = 0;
+    uint32_t depth = 0;
+    uint32_t thread = 0;
+};
+
+struct ProfileFrame {
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    std::vector<ProfileZone> zones;
+};
+
+class Profiler : public hd::Noncopyable {
+    friend class ProfileScope;
+public:
+    static Profiler &get();
+
+    // Moves zones recorded by all threads into the frame history. Called by Engine at the start of every frame
+    void onFrameBegin();
+    // Draws the timeline window. Called by GUISystem when the window is visible
+    void onGUI();
+
+    // Writes the recorded frames in Chrome trace format, returns false if the file couldn't be written
+    bool exportChromeTrace(const std::string &path) const;
+
+    void setEnabled(bool enabled);
+    void setWindowVisible(bool visible);
+    void setThreadName(const std::string &name);
+
+    bool isEnabled() const;
+    bool isWindowVisible() const;
+    uint64_t getDroppedZonesCount() const;
+
+private:
+    static const size_t RING_SIZE = 8192;
+    static const size_t FRAMES_HISTORY_SIZE = 240;
+
+    // Single producer (the owning thread), single consumer (the main thread in onFrameBegin)
+    struct ThreadBuffer {
+        ProfileZone zones[RING_SIZE];
+        std::atomic<uint64_t> head = 0;
+        std::atomic<uint64_t> tail = 0;
+        uint32_t depth = 0;
+        uint32_t index = 0;
+        std::string name;
+    };
+
+    Profiler();
+
+    uint64_t mGetTime() const;
+    ThreadBuffer &mGetThreadBuffer();
+    void mPushZone(ThreadBuffer &buffer, const ProfileZone &zone);
+
+    std::chrono::steady_clock::time_point mStartTime;
+    std::atomic<bool> mIsEnabled;
+    std::atomic<uint64_t> mDroppedZonesCount;
+    bool mIsWindowVisible = false;
+    bool mIsPaused = false;
+    int mSelectedFrame = -1;
+
+    mutable std::mutex mThreadBuffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> mThreadBuffers;
+
+    std::vector<ProfileFrame> mFrames;
+    size_t mNextFrame = 0;
+    ProfileFrame mCurrentFrame;
+    std::vector<float> mFrameTimes;
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char *name);
+    ~ProfileScope();
+
+private:
+    const char *mName;
+    uint64_t mBegin;
+    uint32_t mDepth;
+    bool mIsActive;
+};
+
+}
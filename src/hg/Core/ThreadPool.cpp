@@ -0,0 +1,128 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace hg {
+
+namespace {
+
+struct ParallelForState {
+    const std::function<void(size_t, size_t)> *func;
+    size_t count;
+    size_t batchSize;
+    std::atomic<size_t> nextBatch{0};
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t activeHelpersCount = 0;
+    bool isClosed = false;
+
+    void runBatches() {
+        size_t batchesCount = (count + batchSize - 1) / batchSize;
+        for (size_t batch = nextBatch++; batch < batchesCount; batch = nextBatch++) {
+            size_t begin = batch*batchSize;
+            (*func)(begin, std::min(begin + batchSize, count));
+        }
+    }
+};
+
+}
+
+ThreadPool::ThreadPool(size_t threadsCount) {
+    for (size_t i = 0; i < threadsCount; i++) {
+        mThreads.push_back(std::thread(&ThreadPool::mWorkerFunc, this));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsExit = true;
+    }
+    mCondition.notify_all();
+    for (auto &thread : mThreads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t minBatchSize, const std::function<void(size_t begin, size_t end)> &func) {
+    if (count == 0) {
+        return;
+    }
+
+    // A few batches per thread keep the load balanced when items cost differently
+    size_t batchSize = std::max<size_t>(std::max<size_t>(minBatchSize, 1), count / ((mThreads.size() + 1)*4));
+    size_t batchesCount = (count + batchSize - 1) / batchSize;
+    if (batchesCount == 1 || mThreads.empty()) {
+        func(0, count);
+        return;
+    }
+
+    auto state = std::make_shared<ParallelForState>();
+    state->func = &func;
+    state->count = count;
+    state->batchSize = batchSize;
+
+    size_t helpersCount = std::min(mThreads.size(), batchesCount - 1);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (size_t i = 0; i < helpersCount; i++) {
+            mTasks.push_back([state]() {
+                {
+                    std::lock_guard<std::mutex> stateLock(state->mutex);
+                    if (state->isClosed) {
+                        return;
+                    }
+                    state->activeHelpersCount++;
+                }
+                state->runBatches();
+                {
+                    std::lock_guard<std::mutex> stateLock(state->mutex);
+                    state->activeHelpersCount--;
+                }
+                state->condition.notify_one();
+            });
+        }
+    }
+    mCondition.notify_all();
+
+    state->runBatches();
+
+    // Helpers that haven't started yet are dropped instead of waited for, so nested calls can't deadlock
+    std::unique_lock<std::mutex> stateLock(state->mutex);
+    state->isClosed = true;
+    state->condition.wait(stateLock, [&state]() {
+        return state->activeHelpersCount == 0;
+    });
+}
+
+size_t ThreadPool::getThreadsCount() const {
+    return mThreads.size();
+}
+
+ThreadPool &ThreadPool::get() {
+    // Never destroyed, workers are blocked on the condition when the process exits
+    static ThreadPool *pool = new ThreadPool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+    return *pool;
+}
+
+void ThreadPool::mWorkerFunc() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() {
+                return mIsExit || !mTasks.empty();
+            });
+            if (mIsExit) {
+                return;
+            }
+            task = std::move(mTasks.front());
+            mTasks.pop_front();
+        }
+        task();
+    }
+}
+
+}
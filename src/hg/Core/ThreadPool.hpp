@@ -0,0 +1,36 @@
+#pragma once
+#include "hd/Core/Common.hpp"
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace hg {
+
+class ThreadPool : public hd::Noncopyable {
+public:
+    explicit ThreadPool(size_t threadsCount);
+    ~ThreadPool();
+
+    // Splits [0, count) into batches of at least minBatchSize and runs them on the workers and the calling thread.
+    // Returns when every batch is done. Can be called from inside another parallelFor
+    void parallelFor(size_t count, size_t minBatchSize, const std::function<void(size_t begin, size_t end)> &func);
+
+    size_t getThreadsCount() const;
+
+    static ThreadPool &get();
+
+private:
+    void mWorkerFunc();
+
+    std::vector<std::thread> mThreads;
+    std::deque<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mIsExit = false;
+};
+
+}
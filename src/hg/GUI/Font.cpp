@@ -1,6 +1,7 @@
 #include "Font.hpp"
-#include "hd/Core/StringUtils.hpp"
+#include "../Core/Engine.hpp"
 #include "hd/Core/Log.hpp"
+#include <algorithm>
 
 namespace hg {
 
@@ -20,7 +21,7 @@ hd::Image Font::renderLine(const std::string &text, const glm::vec4 &color) cons
         HD_LOG_WARNING("Rendering fully transparent text line to texture");
     }
 
-    return mRenderLine(text, color);
+    return mRenderLine(text.data(), color);
 }
 
 hd::Image Font::renderText(const std::string &text, const glm::vec4 &color) const {
@@ -31,11 +32,22 @@ hd::Image Font::renderText(const std::string &text, const glm::vec4 &color) cons
         HD_LOG_WARNING("Rendering fully transparent text to texture");
     }
 
-    std::vector<std::string> lines = hd::StringUtils::split(text, "\n", false);
-    auto maxLine = std::max_element(lines.begin(), lines.end(), [&](const std::string &a, const std::string &b){
-        return getTextWidth(a) < getTextWidth(b);
-    });
-    size_t width = getTextWidth(*maxLine);
+    // Lines are cut in place in a per-frame copy of the text, instead of allocating a string for each of them
+    FrameAllocator &frameAllocator = getEngine().getFrameAllocator();
+    FrameString buffer(text.begin(), text.end(), FrameStlAllocator<char>(frameAllocator));
+    FrameVector<const char*> lines{FrameStlAllocator<const char*>(frameAllocator)};
+    lines.push_back(buffer.data());
+    for (char &c : buffer) {
+        if (c == '\n') {
+            c = '\0';
+            lines.push_back(&c + 1);
+        }
+    }
+
+    size_t width = 0;
+    for (const char *line : lines) {
+        width = std::max<size_t>(width, mGetTextWidth(line));
+    }
     size_t height = lines.size()*getLineHeight();
 
     hd::Image img(nullptr, glm::ivec2(width, height), hd::ImageFormat::RGBA);
@@ -70,9 +82,7 @@ uint32_t Font::getLineHeight() const {
 }
 
 uint32_t Font::getTextWidth(const std::string &text) const {
-    int width;
-	TTF_SizeUTF8(mFont, text.data(), &width, nullptr);
-    return static_cast<uint32_t>(width);
+    return mGetTextWidth(text.data());
 }
 
 FontPtr Font::createFromFile(const std::string &path, uint32_t size) {
@@ -88,13 +98,13 @@ FontPtr Font::createFromFile(const std::string &path, uint32_t size) {
     return std::make_shared<Font>(font);
 }
 
-hd::Image Font::mRenderLine(const std::string &text, const glm::vec4 &color) const {
+hd::Image Font::mRenderLine(const char *text, const glm::vec4 &color) const {
     SDL_Color sdlColor;
     sdlColor.r = static_cast<uint8_t>(glm::clamp(color.r*255.0f, 0.0f, 255.0f));
     sdlColor.g = static_cast<uint8_t>(glm::clamp(color.g*255.0f, 0.0f, 255.0f));
     sdlColor.b = static_cast<uint8_t>(glm::clamp(color.b*255.0f, 0.0f, 255.0f));
     sdlColor.a = static_cast<uint8_t>(glm::clamp(color.a*255.0f, 0.0f, 255.0f));
-    SDL_Surface *surface = TTF_RenderUTF8_Blended(mFont, text.data(), sdlColor);
+    SDL_Surface *surface = TTF_RenderUTF8_Blended(mFont, text, sdlColor);
     if (!surface) {
         TTF_CloseFont(mFont);
         HD_LOG_ERROR("Failed to render line '{}'. Error: {}", text, TTF_GetError());
@@ -138,7 +148,7 @@ hd::Image Font::mRenderLine(const std::string &text, const glm::vec4 &color) con
     return img;
 }
 
-void Font::mRenderLineTo(hd::Image &target, uint32_t uOffset, uint32_t vOffset, const std::string &text, const glm::vec4 &color) const {
+void Font::mRenderLineTo(hd::Image &target, uint32_t uOffset, uint32_t vOffset, const char *text, const glm::vec4 &color) const {
     hd::Image img = mRenderLine(text, color);
     for (int y = 0; y < img.getSize().y; y++) {
         const glm::u8vec4 *line = static_cast<const glm::u8vec4*>(img.getData()) + y*img.getSize().x;
@@ -149,6 +159,12 @@ void Font::mRenderLineTo(hd::Image &target, uint32_t uOffset, uint32_t vOffset,
     }
 }
 
+uint32_t Font::mGetTextWidth(const char *text) const {
+    int width;
+	TTF_SizeUTF8(mFont, text, &width, nullptr);
+    return static_cast<uint32_t>(width);
+}
+
 std::string Font::mGetFullPath(const std::string &path) {
     return "./data/" + path;
 }
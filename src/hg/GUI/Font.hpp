@@ -41,8 +41,9 @@ public:
     static FontPtr createFromFile(const std::string &path, uint32_t size);
 
 private:
-    hd::Image mRenderLine(const std::string &text, const glm::vec4 &color) const;
-    void mRenderLineTo(hd::Image &target, uint32_t uOffset, uint32_t vOffset, const std::string &text, const glm::vec4 &color) const;
+    hd::Image mRenderLine(const char *text, const glm::vec4 &color) const;
+    void mRenderLineTo(hd::Image &target, uint32_t uOffset, uint32_t vOffset, const char *text, const glm::vec4 &color) const;
+    uint32_t mGetTextWidth(const char *text) const;
 
     static std::string mGetFullPath(const std::string &path);
 
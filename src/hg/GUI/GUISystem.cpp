@@ -1,6 +1,8 @@
 #include "GUISystem.hpp"
 #include "../Graphics/RenderDevice.hpp"
 #include "../Core/Engine.hpp"
+#include "../Core/Profiler.hpp"
+#include "../Core/MemoryTracker.hpp"
 #include "hd/Core/Log.hpp"
 #include "../../imgui/imgui.h"
 #include "../../imgui/imgui_impl_sdl.h"
@@ -8,6 +10,23 @@
 
 namespace hg {
 
+static void clearDrawData(ImDrawData *drawData, std::vector<ImDrawList*> &drawLists) {
+    for (auto &it : drawLists) {
+        IM_DELETE(it);
+    }
+    drawLists.clear();
+    drawData->Clear();
+}
+
+static void cloneDrawData(const ImDrawData *src, ImDrawData *dst, std::vector<ImDrawList*> &drawLists) {
+    clearDrawData(dst, drawLists);
+    for (int i = 0; i < src->CmdListsCount; i++) {
+        drawLists.push_back(src->CmdLists[i]->CloneOutput());
+    }
+    *dst = *src;
+    dst->CmdLists = drawLists.data();
+}
+
 GUISystem::GUISystem() {
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -15,6 +34,9 @@ GUISystem::GUISystem() {
 
     ImGui::StyleColorsDark();
 
+    mDrawData[0] = IM_NEW(ImDrawData)();
+    mDrawData[1] = IM_NEW(ImDrawData)();
+
     ImGui_ImplSDL2_InitForOpenGL(getEngine().getWindow(), getEngine().getGLContext());
     ImGui_ImplOpenGL3_Init();
 
@@ -32,6 +54,10 @@ GUISystem::~GUISystem() {
     for (auto &it : mFramesDB) {
         HD_DELETE(it.second);
     }
+    for (size_t i = 0; i < 2; i++) {
+        clearDrawData(mDrawData[i], mDrawLists[i]);
+        IM_DELETE(mDrawData[i]);
+    }
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplSDL2_Shutdown();
     ImGui::DestroyContext();
@@ -61,17 +87,26 @@ void GUISystem::onFixedUpdate() {
 }
 
 void GUISystem::onUpdate(float dt) {
-    static bool firstUpdate = true;
-    if (!firstUpdate) {
+    HG_PROFILE_SCOPE("GUISystem::onUpdate");
+    HG_MEMORY_TAG(MemoryTag::GUI);
+    // With the render thread the previous frame was already finished by mSwapFrames
+    if (!mIsFirstUpdate && !getEngine().isRenderThreadEnabled()) {
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     }
-    firstUpdate = false;
+    mIsFirstUpdate = false;
 
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplSDL2_NewFrame(getEngine().getWindow());
     ImGui::NewFrame();
 
+    if (Profiler::get().isWindowVisible()) {
+        Profiler::get().onGUI();
+    }
+    if (MemoryTracker::get().isWindowVisible()) {
+        MemoryTracker::get().onGUI();
+    }
+
     if (mActiveFrame) {
         mActiveFrame->mOnUpdate(dt);
     }
@@ -89,6 +124,7 @@ void GUISystem::setActiveFrame(const std::string &name) {
 }
 
 FontPtr GUISystem::loadFont(const std::string &path, uint32_t size) {
+    HG_MEMORY_TAG(MemoryTag::Resources);
     if (!path.empty()) {
         hd::StringHash pathHash = hd::StringHash(fmt::format("{}@{}", path, size));
         if (mFontsDB.count(pathHash) == 0) {
@@ -110,6 +146,20 @@ const GUISkin &GUISystem::getSkin() const {
     return mSkin;
 }
 
+void GUISystem::mSwapFrames() {
+    // Called on the main thread while the render thread is idle
+    ImGui::Render();
+    cloneDrawData(ImGui::GetDrawData(), mDrawData[mBackDrawData], mDrawLists[mBackDrawData]);
+    mBackDrawData ^= 1;
+}
+
+void GUISystem::mRenderFrontFrame() {
+    ImDrawData *drawData = mDrawData[mBackDrawData ^ 1];
+    if (drawData->Valid) {
+        ImGui_ImplOpenGL3_RenderDrawData(drawData);
+    }
+}
+
 GUISystem &getGUISystem() {
     return getEngine().getGUISystem();
 }
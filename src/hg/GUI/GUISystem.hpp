@@ -6,6 +6,10 @@
 #include "hd/Core/StringHash.hpp"
 #include "hd/Core/Log.hpp"
 #include <unordered_map>
+#include <vector>
+
+struct ImDrawData;
+struct ImDrawList;
 
 namespace hg {
 
@@ -17,6 +21,7 @@ struct GUISkin {
 };
 
 class GUISystem {
+    friend class Engine;
 public:
     GUISystem();
     ~GUISystem();
@@ -47,10 +52,19 @@ public:
     const GUISkin &getSkin() const;
 
 private:
+    void mSwapFrames();
+    void mRenderFrontFrame();
+
     GUISkin mSkin;
     std::unordered_map<hd::StringHash, GUIWidget*> mFramesDB;
     std::unordered_map<hd::StringHash, FontPtr> mFontsDB;
     GUIWidget *mActiveFrame = nullptr;
+    bool mIsFirstUpdate = true;
+
+    // Copies of ImGui draw lists for the render thread
+    ImDrawData *mDrawData[2] = { nullptr, nullptr };
+    std::vector<ImDrawList*> mDrawLists[2];
+    size_t mBackDrawData = 0;
 };
 
 GUISystem &getGUISystem();
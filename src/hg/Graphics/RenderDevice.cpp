@@ -1,5 +1,6 @@
 #include "RenderDevice.hpp"
 #include "../Core/Engine.hpp"
+#include "../Core/MemoryTracker.hpp"
 #include "hd/Core/Log.hpp"
 
 namespace hg {
@@ -263,6 +264,7 @@ void RenderDevice::setRasterizerState(const RasterizerStatePtr &obj) {
 }
 
 Texture2DPtr RenderDevice::loadTexture2D(const std::string &path) {
+    HG_MEMORY_TAG(MemoryTag::Resources);
     if (!path.empty()) {
         hd::StringHash pathHash = hd::StringHash(path);
         if (mTextures2D.count(pathHash) == 0) {
@@ -1,5 +1,7 @@
 #include "RenderSystem2D.hpp"
 #include "../Core/Engine.hpp"
+#include "../Core/Profiler.hpp"
+#include "../Core/MemoryTracker.hpp"
 #include "hd/Math/MathUtils.hpp"
 #include <glm/ext.hpp>
 
@@ -26,6 +28,10 @@ static const float gGUIQuadVerts[] = {
 };
 
 RenderSystem2D::RenderSystem2D() {
+    if (getEngine().isHeadless()) {
+        return;
+    }
+
     mVF = VertexFormat::create({
         VertexAttrib(AttribType::Float3, 0, 0, 0, false, false),
         VertexAttrib(AttribType::Float2, 1, 0, sizeof(float[3]), false, false),
@@ -52,43 +58,47 @@ RenderSystem2D::~RenderSystem2D() {
 }
 
 void RenderSystem2D::onUpdate(float dt) {
-    getRenderDevice().clearRenderTarget(glm::vec4(0.5f, 0.5f, 1.0f, 1.0f));
-    getRenderDevice().clearDepthStencil(1.0f, 0);
-
-    getRenderDevice().setBlendState(BlendMode::Alpha);
-
-    glm::vec2 windowSize = getEngine().getWindowSize();
-
-    float aspect = windowSize.y / windowSize.x;
-    mProjMat = glm::ortho(-1.0f*mCamDistance, 1.0f*mCamDistance, -1.0f*aspect*mCamDistance, 1.0f*aspect*mCamDistance, -100.0f, 100.0f);
-    mViewMat = glm::rotate(glm::mat4(1.0f), -mCamAngle, glm::vec3(0, 0, 1));
-    mViewMat = glm::translate(mViewMat, glm::vec3(-mCamPos, 0.0f));
-    mInvViewMat = glm::inverse(mViewMat);
-
-    mDraw(mProjMat*mViewMat);
-    mRenderOps.clear();
-
-    glm::mat4 projGUI = hd::MathUtils::ortho2D(0, windowSize.x, windowSize.y, 0);
-    mDrawGUI(projGUI);
-    mGUIRenderOps.clear();
+    HG_PROFILE_SCOPE("RenderSystem2D::onUpdate");
+    HG_MEMORY_TAG(MemoryTag::Render);
+    RenderFrame &frame = mFrames[mBackFrame];
+    mUpdateMatrices(frame);
+    if (!getEngine().isHeadless()) {
+        mRenderFrame(frame);
+    }
+    frame.renderOps.clear();
+    frame.guiRenderOps.clear();
 }
 
 void RenderSystem2D::drawTexture(const Texture2DPtr &texture, const glm::vec3 &pos, const glm::vec2 &size, float angle) {
+    HG_MEMORY_TAG(MemoryTag::Render);
     RenderOp rop;
     rop.texture = texture;
     rop.pos = pos;
     rop.size = size;
     rop.angle = angle;
-    mRenderOps.push_back(rop);
+    mFrames[mBackFrame].renderOps.push_back(rop);
+}
+
+void RenderSystem2D::drawMesh(const Texture2DPtr &texture, const BufferPtr &mesh, uint32_t vertexCount, const glm::vec3 &pos, float angle) {
+    HG_MEMORY_TAG(MemoryTag::Render);
+    RenderOp rop;
+    rop.texture = texture;
+    rop.pos = pos;
+    rop.size = glm::vec2(1, 1);
+    rop.angle = angle;
+    rop.mesh = mesh;
+    rop.vertexCount = vertexCount;
+    mFrames[mBackFrame].renderOps.push_back(rop);
 }
 
 void RenderSystem2D::drawTextureGUI(const Texture2DPtr &texture, const glm::ivec2 &pos, const glm::ivec2 &size) {
+    HG_MEMORY_TAG(MemoryTag::Render);
     RenderOp rop;
     rop.texture = texture;
     rop.pos = glm::vec3(pos, 0);
     rop.size = size;
     rop.angle = 0.0f;
-    mGUIRenderOps.push_back(rop);
+    mFrames[mBackFrame].guiRenderOps.push_back(rop);
 }
 
 void RenderSystem2D::setCamera(const glm::vec2 &pos, float angle, float distance) {
@@ -111,7 +121,43 @@ glm::vec2 RenderSystem2D::transformWorldToWindow(const glm::vec2 &pos) const {
     return world;
 }
 
-void RenderSystem2D::mDraw(const glm::mat4 &projView) {
+void RenderSystem2D::mUpdateMatrices(RenderFrame &frame) {
+    glm::vec2 windowSize = getEngine().getWindowSize();
+
+    float aspect = windowSize.y / windowSize.x;
+    mProjMat = glm::ortho(-1.0f*mCamDistance, 1.0f*mCamDistance, -1.0f*aspect*mCamDistance, 1.0f*aspect*mCamDistance, -100.0f, 100.0f);
+    mViewMat = glm::rotate(glm::mat4(1.0f), -mCamAngle, glm::vec3(0, 0, 1));
+    mViewMat = glm::translate(mViewMat, glm::vec3(-mCamPos, 0.0f));
+    mInvViewMat = glm::inverse(mViewMat);
+
+    frame.projView = mProjMat*mViewMat;
+    frame.projGUI = hd::MathUtils::ortho2D(0, windowSize.x, windowSize.y, 0);
+}
+
+void RenderSystem2D::mSwapFrames() {
+    // Called on the main thread while the render thread is idle
+    mUpdateMatrices(mFrames[mBackFrame]);
+    mBackFrame ^= 1;
+    mFrames[mBackFrame].renderOps.clear();
+    mFrames[mBackFrame].guiRenderOps.clear();
+}
+
+void RenderSystem2D::mRenderFrame(const RenderFrame &frame) {
+    getRenderDevice().clearRenderTarget(glm::vec4(0.5f, 0.5f, 1.0f, 1.0f));
+    getRenderDevice().clearDepthStencil(1.0f, 0);
+
+    getRenderDevice().setBlendState(BlendMode::Alpha);
+
+    mDraw(frame.projView, frame.renderOps);
+    mDrawGUI(frame.projGUI, frame.guiRenderOps);
+}
+
+void RenderSystem2D::mRenderFrontFrame() {
+    mRenderFrame(mFrames[mBackFrame ^ 1]);
+}
+
+void RenderSystem2D::mDraw(const glm::mat4 &projView, const std::vector<RenderOp> &renderOps) {
+    HG_PROFILE_SCOPE("RenderSystem2D::mDraw");
     getRenderDevice().setDepthStencilState(mQuadDSS);
 
     getRenderDevice().setVertexShader(mVS);
@@ -120,20 +166,26 @@ void RenderSystem2D::mDraw(const glm::mat4 &projView) {
     mVS->setUniform(mQuadVSProjViewMatID, projView);
 
     getRenderDevice().setVertexFormat(mVF);
-    getRenderDevice().setVertexBuffer(mQuadVB, 0, 0, sizeof(float[5]));
-    for (const auto &rop : mRenderOps) {
+    const Buffer *currentVB = nullptr;
+    for (const auto &rop : renderOps) {
         glm::mat4 translate = glm::translate(glm::mat4(1.0f), rop.pos);
         glm::mat4 rotate = glm::rotate(glm::mat4(1.0f), rop.angle, glm::vec3(0, 0, 1));
         glm::mat4 scale = glm::scale(glm::mat4(1.0f), glm::vec3(rop.size, 1.0f));
         glm::mat4 world = translate*rotate*scale;
         mVS->setUniform(mQuadVSWorldMatID, world);
 
+        const BufferPtr &vb = rop.mesh ? rop.mesh : mQuadVB;
+        if (vb.get() != currentVB) {
+            getRenderDevice().setVertexBuffer(vb, 0, 0, sizeof(float[5]));
+            currentVB = vb.get();
+        }
         getRenderDevice().setTexture(rop.texture, 0);
-        getRenderDevice().draw(PrimitiveType::Triangles, 0, 6);
+        getRenderDevice().draw(PrimitiveType::Triangles, 0, rop.mesh ? rop.vertexCount : 6);
     }
 }
 
-void RenderSystem2D::mDrawGUI(const glm::mat4 &projView) {
+void RenderSystem2D::mDrawGUI(const glm::mat4 &projView, const std::vector<RenderOp> &renderOps) {
+    HG_PROFILE_SCOPE("RenderSystem2D::mDrawGUI");
     getRenderDevice().setDepthStencilState(mGUIQuadDSS);
 
     getRenderDevice().setVertexShader(mVS);
@@ -143,7 +195,7 @@ void RenderSystem2D::mDrawGUI(const glm::mat4 &projView) {
 
     getRenderDevice().setVertexFormat(mVF);
     getRenderDevice().setVertexBuffer(mGUIQuadVB, 0, 0, sizeof(float[5]));
-    for (const auto &rop : mGUIRenderOps) {
+    for (const auto &rop : renderOps) {
         glm::mat4 translate = glm::translate(glm::mat4(1.0f), rop.pos);
         glm::mat4 rotate = glm::rotate(glm::mat4(1.0f), rop.angle, glm::vec3(0, 0, 1));
         glm::mat4 scale = glm::scale(glm::mat4(1.0f), glm::vec3(rop.size, 1.0f));
@@ -9,9 +9,19 @@ struct RenderOp {
     glm::vec3 pos = glm::vec3(0, 0, 0);
     glm::vec2 size = glm::vec2(0, 0);
     float angle = 0.0f;
+    BufferPtr mesh = nullptr; // triangles in the quad vertex layout (pos3, uv2), the unit quad if null
+    uint32_t vertexCount = 0;
+};
+
+struct RenderFrame {
+    std::vector<RenderOp> renderOps;
+    std::vector<RenderOp> guiRenderOps;
+    glm::mat4 projView = glm::mat4(1.0f);
+    glm::mat4 projGUI = glm::mat4(1.0f);
 };
 
 class RenderSystem2D {
+    friend class Engine;
 public:
     RenderSystem2D();
     ~RenderSystem2D();
@@ -19,6 +29,8 @@ public:
     void onUpdate(float dt);
 
     void drawTexture(const Texture2DPtr &texture, const glm::vec3 &pos, const glm::vec2 &size, float angle);
+    // The buffer must not be updated afterwards, the render thread may still draw it. Create a new one instead
+    void drawMesh(const Texture2DPtr &texture, const BufferPtr &mesh, uint32_t vertexCount, const glm::vec3 &pos, float angle);
     void drawTextureGUI(const Texture2DPtr &texture, const glm::ivec2 &pos, const glm::ivec2 &size);
 
     void setCamera(const glm::vec2 &pos, float angle, float distance);
@@ -27,16 +39,21 @@ public:
     glm::vec2 transformWorldToWindow(const glm::vec2 &pos) const;
 
 private:
-    void mDraw(const glm::mat4 &projView);
-    void mDrawGUI(const glm::mat4 &projView);
+    void mUpdateMatrices(RenderFrame &frame);
+    void mSwapFrames();
+    void mRenderFrame(const RenderFrame &frame);
+    void mRenderFrontFrame();
+    void mDraw(const glm::mat4 &projView, const std::vector<RenderOp> &renderOps);
+    void mDrawGUI(const glm::mat4 &projView, const std::vector<RenderOp> &renderOps);
 
     glm::vec2 mCamPos = glm::vec2(0, 0);
     float mCamAngle = 0.0f, mCamDistance = 1.0f;
     glm::mat4 mProjMat = glm::mat4(1.0f);
     glm::mat4 mViewMat = glm::mat4(1.0f);
     glm::mat4 mInvViewMat = glm::mat4(1.0f);
-    std::vector<RenderOp> mRenderOps;
-    std::vector<RenderOp> mGUIRenderOps;
+    // Ops are recorded into the back frame. With the render thread the front frame is drawn while the next one is recorded
+    RenderFrame mFrames[2];
+    size_t mBackFrame = 0;
 
     VertexFormatPtr mVF;
     BufferPtr mQuadVB, mGUIQuadVB;
@@ -1,4 +1,5 @@
 #include "Component.hpp"
+#include "Scene.hpp"
 
 namespace hg {
 
@@ -23,8 +24,16 @@ void Component::onFixedUpdate() {
 void Component::onUpdate(float dt) {
 }
 
+void Component::destroyDeferred() {
+    getScene().mQueueDestroy(this);
+}
+
 GameObject *Component::getOwner() const {
     return mOwner;
 }
 
+bool Component::isPendingDestroy() const {
+    return mIsPendingDestroy;
+}
+
 }
@@ -10,6 +10,7 @@ class GameObject;
 class Component : public Object {
     HG_OBJECT(Component, Object);
     friend class GameObject;
+    friend class Scene;
 public:
     virtual void onSaveLoad(hd::JSON &data, bool isLoad);
     virtual void onCreate();
@@ -19,10 +20,17 @@ public:
     virtual void onFixedUpdate();
     virtual void onUpdate(float dt);
 
+    void destroyDeferred();
+
     GameObject *getOwner() const;
+    bool isPendingDestroy() const;
 
 private:
     GameObject *mOwner = nullptr;
+    size_t mPendingDestroyIndex = 0;
+    size_t mFirstUpdateIndex = 0;
+    bool mIsPendingDestroy = false;
+    bool mIsWaitingFirstUpdate = false;
 };
 
 }
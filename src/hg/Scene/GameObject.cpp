@@ -1,30 +1,36 @@
 #include "GameObject.hpp"
 #include "Scene.hpp"
+#include "Prefab.hpp"
+#include "../Core/BinaryArchive.hpp"
 #include "hd/Math/MathUtils.hpp"
 #include "hd/IO/FileStream.hpp"
 
 namespace hg {
 
 GameObject::~GameObject() {
+    if (mIsPendingDestroy) {
+        getScene().mCancelDestroy(this);
+    }
     destroyAllChildren();
     destroyAllComponents();
 }
 
 GameObject *GameObject::createChild() {
     GameObject *go = new GameObject();
+    go->mIndexInParent = mChildren.size();
     mChildren.push_back(go);
     go->mParent = this;
     return go;
 }
 
 GameObject *GameObject::createChildFromFile(const std::string &path) {
-    hd::FileStream file = hd::FileStream(mGetFullPath(path), hd::FileMode::Read);
-    std::string text = file.readAllText();
+    return getScene().loadPrefab(path)->instantiate(this);
+}
 
-    hd::JSON data = hd::JSON::parse(text);
-    GameObject *child = createChild();
-    child->mOnSaveLoad(data, true);
-    return child;
+std::vector<GameObject*> GameObject::createChildrenFromFile(const std::string &path, size_t count) {
+    std::vector<GameObject*> children;
+    getScene().loadPrefab(path)->instantiate(this, count, children);
+    return children;
 }
 
 void GameObject::saveToFile(const std::string &path) {
@@ -36,13 +42,50 @@ void GameObject::saveToFile(const std::string &path) {
     file.writeLine(text);
 }
 
+void GameObject::saveToBinaryFile(const std::string &path) {
+    hd::JSON data;
+    mOnSaveLoad(data, false);
+    std::vector<uint8_t> buffer = BinaryArchive::write(data);
+
+    hd::FileStream file = hd::FileStream(mGetFullPath(path), hd::FileMode::Write);
+    file.write(buffer.data(), buffer.size());
+}
+
 void GameObject::destroyChild(GameObject *go) {
     if (go) {
-        mChildren.erase(std::remove(mChildren.begin(), mChildren.end(), go), mChildren.end());
+        if (go->mParent != this || go->mIndexInParent >= mChildren.size() || mChildren[go->mIndexInParent] != go) {
+            HD_LOG_WARNING("Failed to destroy GameObject '{}'. It isn't a child of '{}'", go->getName(), getName());
+            return;
+        }
+
+        // Keeps siblings order and indexes, so loops over the children don't skip anyone.
+        // Slots are compacted once more than half of them are empty and no loop is running
+        mRemoveFromNameIndex(go);
+        mChildren[go->mIndexInParent] = nullptr;
+        mDestroyedChildrenCount++;
         HD_DELETE(go);
+        mCompactChildrenIfNeeded();
+    }
+}
+
+void GameObject::destroyChildDeferred(GameObject *go) {
+    if (go) {
+        if (go->mParent != this) {
+            HD_LOG_WARNING("Failed to destroy GameObject '{}'. It isn't a child of '{}'", go->getName(), getName());
+            return;
+        }
+        go->destroyDeferred();
     }
 }
 
+void GameObject::destroyDeferred() {
+    if (!mParent) {
+        HD_LOG_WARNING("Failed to destroy GameObject '{}' without parent", getName());
+        return;
+    }
+    getScene().mQueueDestroy(this);
+}
+
 Component *GameObject::createComponent(const hd::StringHash &typeHash) {
     // component was deleted by mCreateComponent if something goes wrong
     Component *component = Factory::get().createObject(typeHash)->as<Component>();
@@ -62,9 +105,13 @@ void GameObject::destroyComponent(const hd::StringHash &typeHash) {
 
 void GameObject::destroyAllChildren() {
     for (auto &it : mChildren) {
-        HD_DELETE(it);
+        if (it) {
+            HD_DELETE(it);
+        }
     }
     mChildren.clear();
+    mDestroyedChildrenCount = 0;
+    mChildrenByName.clear();
 }
 
 void GameObject::destroyAllComponents() {
@@ -95,8 +142,14 @@ void GameObject::rotate(float angle) {
 }
 
 void GameObject::setName(const std::string &name) {
+    if (mParent) {
+        mParent->mRemoveFromNameIndex(this);
+    }
     mName = name;
     mNameHash = hd::StringHash(name);
+    if (mParent) {
+        mParent->mAddToNameIndex(this);
+    }
 }
 
 void GameObject::setActive(bool active) {
@@ -136,6 +189,12 @@ void GameObject::setWorldAngle(float angle) {
     setAngle(transformAngleWorldToLocal(angle));
 }
 
+void GameObject::setWorldTransform(const glm::vec2 &pos, float angle) {
+    mPos = transformPositionWorldToLocal(pos);
+    mAngle = transformAngleWorldToLocal(angle);
+    mUpdateTransform();
+}
+
 glm::vec2 GameObject::transformPositionLocalToWorld(const glm::vec2 &pos) const {
     glm::vec2 worldPos = glm::vec2(0, 0);
     const GameObject *go = this;
@@ -186,14 +245,42 @@ GameObject *GameObject::findChildByName(const std::string &name) const {
         HD_LOG_FATAL("Invalid name '{}'", name);
     }
 
-    hd::StringHash nameHash = hd::StringHash(name);
-    auto it = std::find_if(mChildren.begin(), mChildren.end(), [&](const GameObject *go) {
-        return go->getNameHash() == nameHash;
-    });
-    if (it == mChildren.end()) {
+    GameObject *go = mFindChildByHash(hd::StringHash(name));
+    if (!go) {
         HD_LOG_FATAL("GameObject '{}' not found", name);
     }
-    return *it;
+    return go;
+}
+
+GameObject *GameObject::findChild(const GameObjectPath &path) const {
+    if (path.isEmpty()) {
+        HD_LOG_FATAL("Invalid path '{}'", path.getString());
+    }
+
+    GameObject *go = tryFindChild(path);
+    if (!go) {
+        HD_LOG_FATAL("GameObject '{}' not found", path.getString());
+    }
+    return go;
+}
+
+GameObject *GameObject::tryFindChildByName(const std::string &name) const {
+    return name.empty() ? nullptr : mFindChildByHash(hd::StringHash(name));
+}
+
+GameObject *GameObject::tryFindChild(const GameObjectPath &path) const {
+    if (path.isEmpty()) {
+        return nullptr;
+    }
+
+    const GameObject *go = this;
+    for (const auto &segment : path.getSegments()) {
+        go = go->mFindChildByHash(segment);
+        if (!go) {
+            return nullptr;
+        }
+    }
+    return const_cast<GameObject*>(go);
 }
 
 Component *GameObject::findComponent(const hd::StringHash &typeHash) const {
@@ -227,6 +314,10 @@ bool GameObject::isActive() const {
     return mIsActive;
 }
 
+bool GameObject::isPendingDestroy() const {
+    return mIsPendingDestroy;
+}
+
 const glm::vec2 &GameObject::getPosition() const {
     return mPos;
 }
@@ -281,7 +372,10 @@ void GameObject::mOnSaveLoad(hd::JSON &data, bool isLoad) {
             it->onSaveLoad(comp, isLoad);
         }
 
-        for (const auto &it : mChildren) {
+        for (const auto &it : getChildren()) {
+            if (!it) {
+                continue;
+            }
             hd::JSON child;
             it->mOnSaveLoad(child, isLoad);
             children.push_back(child);
@@ -289,39 +383,64 @@ void GameObject::mOnSaveLoad(hd::JSON &data, bool isLoad) {
     }
 }
 
+// Loops below go by index, because callbacks may create children and components.
+// Objects created during the loop are visited in the same pass, destroyed ones are skipped until reclaimed by the Scene
+// or left as null slots by destroyChild
+
 void GameObject::mOnEvent(const WindowEvent &event) {
-    if (isActive()) {
-        for (auto &it : mComponents) {
-            it->onEvent(event);
+    if (isActive() && !isPendingDestroy()) {
+        for (size_t i = 0; i < mComponents.size(); i++) {
+            if (!mComponents[i]->isPendingDestroy()) {
+                mComponents[i]->onEvent(event);
+            }
         }
 
-        for (const auto &it : mChildren) {
-            it->mOnEvent(event);
+        mChildrenLoopsCount++;
+        for (size_t i = 0; i < mChildren.size(); i++) {
+            if (mChildren[i]) {
+                mChildren[i]->mOnEvent(event);
+            }
         }
+        mChildrenLoopsCount--;
+        mCompactChildrenIfNeeded();
     }
 }
 
 void GameObject::mOnFixedUpdate() {
-    if (isActive()) {
-        for (auto &it : mComponents) {
-            it->onFixedUpdate();
+    if (isActive() && !isPendingDestroy()) {
+        for (size_t i = 0; i < mComponents.size(); i++) {
+            if (!mComponents[i]->isPendingDestroy()) {
+                mComponents[i]->onFixedUpdate();
+            }
         }
 
-        for (const auto &it : mChildren) {
-            it->mOnFixedUpdate();
+        mChildrenLoopsCount++;
+        for (size_t i = 0; i < mChildren.size(); i++) {
+            if (mChildren[i]) {
+                mChildren[i]->mOnFixedUpdate();
+            }
         }
+        mChildrenLoopsCount--;
+        mCompactChildrenIfNeeded();
     }
 }
 
 void GameObject::mOnUpdate(float dt) {
-    if (isActive()) {
-        for (auto &it : mComponents) {
-            it->onUpdate(dt);
+    if (isActive() && !isPendingDestroy()) {
+        for (size_t i = 0; i < mComponents.size(); i++) {
+            if (!mComponents[i]->isPendingDestroy()) {
+                mComponents[i]->onUpdate(dt);
+            }
         }
 
-        for (const auto &it : mChildren) {
-            it->mOnUpdate(dt);
+        mChildrenLoopsCount++;
+        for (size_t i = 0; i < mChildren.size(); i++) {
+            if (mChildren[i]) {
+                mChildren[i]->mOnUpdate(dt);
+            }
         }
+        mChildrenLoopsCount--;
+        mCompactChildrenIfNeeded();
     }
 }
 
@@ -348,6 +467,7 @@ Component *GameObject::mCreateComponent(Component *component) {
 }
 
 void GameObject::mDestroyComponent(Component *component) {
+    getScene().mOnDestroyComponent(component);
     HD_DELETE(component);
 }
 
@@ -359,9 +479,112 @@ void GameObject::mUpdateTransform() {
         component->onTransformUpdate();
     }
 
+    mChildrenLoopsCount++;
+    for (size_t i = 0; i < mChildren.size(); i++) {
+        if (mChildren[i]) {
+            mChildren[i]->mUpdateTransform();
+        }
+    }
+    mChildrenLoopsCount--;
+    mCompactChildrenIfNeeded();
+}
+
+void GameObject::mAddToNameIndex(GameObject *child) {
+    // The first child with a given name wins, like the linear search did. Later ones are linked after it
+    if (child->getName().empty()) {
+        return;
+    }
+    child->mPrevSameName = nullptr;
+    child->mNextSameName = nullptr;
+    auto it = mChildrenByName.find(child->getNameHash());
+    if (it != mChildrenByName.end()) {
+        child->mPrevSameName = it->second.last;
+        it->second.last->mNextSameName = child;
+        it->second.last = child;
+    }
+    else {
+        mChildrenByName.emplace(child->getNameHash(), NameIndexEntry{ child, child });
+    }
+}
+
+void GameObject::mRemoveFromNameIndex(GameObject *child) {
+    if (child->getName().empty()) {
+        return;
+    }
+    auto it = mChildrenByName.find(child->getNameHash());
+    if (it == mChildrenByName.end()) {
+        return;
+    }
+    NameIndexEntry &entry = it->second;
+    if (child->mPrevSameName) {
+        child->mPrevSameName->mNextSameName = child->mNextSameName;
+    }
+    else {
+        entry.first = child->mNextSameName;
+    }
+    if (child->mNextSameName) {
+        child->mNextSameName->mPrevSameName = child->mPrevSameName;
+    }
+    else {
+        entry.last = child->mPrevSameName;
+    }
+    child->mPrevSameName = nullptr;
+    child->mNextSameName = nullptr;
+    if (!entry.first) {
+        mChildrenByName.erase(it);
+    }
+}
+
+GameObject *GameObject::mFindChildByHash(const hd::StringHash &nameHash) const {
+    auto it = mChildrenByName.find(nameHash);
+    return it != mChildrenByName.end() ? it->second.first : nullptr;
+}
+
+void GameObject::mRemoveDestroyedComponent(Component *component) {
+    auto it = std::find(mComponents.begin(), mComponents.end(), component);
+    if (it != mComponents.end()) {
+        mComponents.erase(it);
+        mDestroyComponent(component);
+    }
+}
+
+void GameObject::mRemoveDestroyedChildren(std::vector<GameObject*> &destroyed) {
+    // Single stable compaction pass, so removing any number of children is linear
+    size_t count = 0;
     for (auto &child : mChildren) {
-        child->mUpdateTransform();
+        if (!child) {
+            continue;
+        }
+        if (child->mIsPendingDestroy) {
+            mRemoveFromNameIndex(child);
+            destroyed.push_back(child);
+        }
+        else {
+            child->mIndexInParent = count;
+            mChildren[count++] = child;
+        }
+    }
+    mChildren.resize(count);
+    mDestroyedChildrenCount = 0;
+    mHasPendingDestroyChildren = false;
+}
+
+void GameObject::mCompactChildrenIfNeeded() {
+    if (mChildrenLoopsCount == 0 && mDestroyedChildrenCount*2 > mChildren.size()) {
+        mCompactChildren();
+    }
+}
+
+void GameObject::mCompactChildren() {
+    size_t count = 0;
+    for (auto &child : mChildren) {
+        if (child) {
+            child->mIndexInParent = count;
+            mChildren[count++] = child;
+        }
     }
+    mChildren.resize(count);
+    mDestroyedChildrenCount = 0;
 }
 
 }
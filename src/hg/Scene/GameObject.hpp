@@ -1,5 +1,7 @@
 #pragma once
 #include "Component.hpp"
+#include "GameObjectPath.hpp"
+#include "../Core/PoolAllocator.hpp"
 #include <glm/glm.hpp>
 #include <vector>
 #include <unordered_map>
@@ -7,6 +9,9 @@
 namespace hg {
 
 class GameObject {
+    HG_POOLED_OBJECT(GameObject);
+    friend class Prefab;
+    friend class Scene;
 public:
     virtual ~GameObject();
 
@@ -16,8 +21,12 @@ public:
 
     GameObject *createChild();
     GameObject *createChildFromFile(const std::string &path);
+    std::vector<GameObject*> createChildrenFromFile(const std::string &path, size_t count);
     void saveToFile(const std::string &path);
+    void saveToBinaryFile(const std::string &path);
     void destroyChild(GameObject *go);
+    void destroyChildDeferred(GameObject *go);
+    void destroyDeferred();
 
     Component *createComponent(const hd::StringHash &typeHash);
     void destroyComponent(const hd::StringHash &typeHash);
@@ -40,6 +49,7 @@ public:
     void setSize(const glm::vec2 &size);
     void setAngle(float angle);
     void setWorldAngle(float angle);
+    void setWorldTransform(const glm::vec2 &pos, float angle);
 
     glm::vec2 transformPositionLocalToWorld(const glm::vec2 &pos) const;
     glm::vec2 transformPositionWorldToLocal(const glm::vec2 &pos) const;
@@ -47,13 +57,18 @@ public:
     float transformAngleWorldToLocal(float angle) const;
 
     GameObject *findChildByName(const std::string &name) const;
+    GameObject *findChild(const GameObjectPath &path) const;
+    GameObject *tryFindChildByName(const std::string &name) const;
+    GameObject *tryFindChild(const GameObjectPath &path) const;
     Component *findComponent(const hd::StringHash &typeHash) const;
 
     GameObject *getParent() const;
+    // May hold nullptr in place of children destroyed by destroyChild, until they are compacted
     const std::vector<GameObject*> &getChildren() const;
     const std::string &getName() const;
     const hd::StringHash &getNameHash() const;
     bool isActive() const;
+    bool isPendingDestroy() const;
     const glm::vec2 &getPosition() const;
     const glm::vec2 &getWorldPosition() const;
     const glm::vec2 &getSize() const;
@@ -72,9 +87,32 @@ private:
     Component *mCreateComponent(Component *component);
     void mDestroyComponent(Component *component);
     void mUpdateTransform();
+    void mAddToNameIndex(GameObject *child);
+    void mRemoveFromNameIndex(GameObject *child);
+    GameObject *mFindChildByHash(const hd::StringHash &nameHash) const;
+    void mRemoveDestroyedChildren(std::vector<GameObject*> &destroyed);
+    void mCompactChildrenIfNeeded();
+    void mCompactChildren();
+    void mRemoveDestroyedComponent(Component *component);
 
     GameObject *mParent = nullptr;
+    size_t mIndexInParent = 0;
+    size_t mPendingDestroyIndex = 0;
+    bool mIsPendingDestroy = false;
+    bool mHasPendingDestroyChildren = false;
+    // Children with the same name are linked in the order they were indexed, so any of them is removed in O(1)
+    struct NameIndexEntry {
+        GameObject *first;
+        GameObject *last;
+    };
+    GameObject *mPrevSameName = nullptr;
+    GameObject *mNextSameName = nullptr;
+
+    // destroyChild leaves null slots, they are compacted in one pass when there are too many and no loop over them runs
     std::vector<GameObject*> mChildren;
+    size_t mDestroyedChildrenCount = 0;
+    uint32_t mChildrenLoopsCount = 0;
+    std::unordered_map<hd::StringHash, NameIndexEntry> mChildrenByName;
     std::vector<Component*> mComponents;
     std::string mName = "";
     hd::StringHash mNameHash;
@@ -88,7 +126,7 @@ private:
 
 template<typename T>
 T *GameObject::createComponent() {
-    T *component = new T(); // it was deleted by mCreateComponent if something goes wrong
+    T *component = new T(); // allocated from the type pool, returned to it by mCreateComponent if something goes wrong
     return static_cast<T*>(mCreateComponent(component));
 }
 
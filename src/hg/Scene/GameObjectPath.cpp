@@ -0,0 +1,31 @@
+#include "GameObjectPath.hpp"
+#include "hd/Core/StringUtils.hpp"
+
+namespace hg {
+
+GameObjectPath::GameObjectPath(const std::string &path) : mPath(path) {
+    std::vector<std::string> names = hd::StringUtils::split(path, "/", false);
+    mSegments.reserve(names.size());
+    for (const auto &name : names) {
+        if (!name.empty()) {
+            mSegments.push_back(hd::StringHash(name));
+        }
+    }
+}
+
+GameObjectPath::GameObjectPath(const char *path) : GameObjectPath(std::string(path)) {
+}
+
+const std::string &GameObjectPath::getString() const {
+    return mPath;
+}
+
+const std::vector<hd::StringHash> &GameObjectPath::getSegments() const {
+    return mSegments;
+}
+
+bool GameObjectPath::isEmpty() const {
+    return mSegments.empty();
+}
+
+}
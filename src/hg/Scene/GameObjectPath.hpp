@@ -0,0 +1,24 @@
+#pragma once
+#include "hd/Core/StringHash.hpp"
+#include <string>
+#include <vector>
+
+namespace hg {
+
+// Slash-separated child path ("ui/hud/health"), split and hashed once so it can be cached and reused
+class GameObjectPath {
+public:
+    GameObjectPath() = default;
+    GameObjectPath(const std::string &path);
+    GameObjectPath(const char *path);
+
+    const std::string &getString() const;
+    const std::vector<hd::StringHash> &getSegments() const;
+    bool isEmpty() const;
+
+private:
+    std::string mPath;
+    std::vector<hd::StringHash> mSegments;
+};
+
+}
@@ -0,0 +1,110 @@
+#include "PhysicsSnapshot.hpp"
+#include "hd/Core/Log.hpp"
+#include <algorithm>
+
+namespace hg {
+
+void PhysicsSnapshot::reserve(size_t bodiesCount) {
+    mData.reserve(sizeof(Header) + bodiesCount*sizeof(BodyState));
+}
+
+void PhysicsSnapshot::clear() {
+    mSize = 0;
+}
+
+uint64_t PhysicsSnapshot::getStepIndex() const {
+    return isEmpty() ? 0 : mGetHeader().stepIndex;
+}
+
+uint32_t PhysicsSnapshot::getBodiesCount() const {
+    return isEmpty() ? 0 : mGetHeader().bodiesCount;
+}
+
+const uint8_t *PhysicsSnapshot::getData() const {
+    return mData.data();
+}
+
+size_t PhysicsSnapshot::getDataSize() const {
+    return mSize;
+}
+
+bool PhysicsSnapshot::isEmpty() const {
+    return mSize == 0;
+}
+
+void PhysicsSnapshot::mResize(size_t bodiesCount) {
+    mSize = sizeof(Header) + bodiesCount*sizeof(BodyState);
+    if (mData.size() < mSize) {
+        mData.resize(mSize);
+    }
+}
+
+PhysicsSnapshot::Header &PhysicsSnapshot::mGetHeader() {
+    return *reinterpret_cast<Header*>(mData.data());
+}
+
+const PhysicsSnapshot::Header &PhysicsSnapshot::mGetHeader() const {
+    return *reinterpret_cast<const Header*>(mData.data());
+}
+
+PhysicsSnapshot::BodyState *PhysicsSnapshot::mGetBodies() {
+    return reinterpret_cast<BodyState*>(mData.data() + sizeof(Header));
+}
+
+const PhysicsSnapshot::BodyState *PhysicsSnapshot::mGetBodies() const {
+    return reinterpret_cast<const BodyState*>(mData.data() + sizeof(Header));
+}
+
+PhysicsSnapshotRing::PhysicsSnapshotRing(size_t capacity, size_t bodiesCount) {
+    if (capacity == 0) {
+        HD_LOG_FATAL("Snapshot ring capacity must be greater than zero");
+    }
+    mSnapshots.resize(capacity);
+    for (auto &snapshot : mSnapshots) {
+        snapshot.reserve(bodiesCount);
+    }
+}
+
+PhysicsSnapshot &PhysicsSnapshotRing::push() {
+    PhysicsSnapshot &snapshot = mSnapshots[mNext];
+    snapshot.clear();
+    mNext = (mNext + 1) % mSnapshots.size();
+    mSize = std::min(mSize + 1, mSnapshots.size());
+    return snapshot;
+}
+
+void PhysicsSnapshotRing::clear() {
+    for (auto &snapshot : mSnapshots) {
+        snapshot.clear();
+    }
+    mNext = 0;
+    mSize = 0;
+}
+
+const PhysicsSnapshot *PhysicsSnapshotRing::find(uint64_t stepIndex) const {
+    for (size_t i = 0; i < mSize; i++) {
+        const PhysicsSnapshot &snapshot = mSnapshots[(mNext + mSnapshots.size() - 1 - i) % mSnapshots.size()];
+        if (!snapshot.isEmpty() && snapshot.getStepIndex() == stepIndex) {
+            return &snapshot;
+        }
+    }
+    return nullptr;
+}
+
+const PhysicsSnapshot *PhysicsSnapshotRing::getLatest() const {
+    if (mSize == 0) {
+        return nullptr;
+    }
+    const PhysicsSnapshot &snapshot = mSnapshots[(mNext + mSnapshots.size() - 1) % mSnapshots.size()];
+    return snapshot.isEmpty() ? nullptr : &snapshot;
+}
+
+size_t PhysicsSnapshotRing::getCapacity() const {
+    return mSnapshots.size();
+}
+
+size_t PhysicsSnapshotRing::getSize() const {
+    return mSize;
+}
+
+}
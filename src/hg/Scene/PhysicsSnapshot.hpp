@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace hg {
+
+// Binary state of every RigidBody of a PhysicsWorld at one step: transform, velocities and awake flag.
+// The buffer keeps its capacity, so saving into a reused snapshot doesn't allocate once it's big enough
+class PhysicsSnapshot {
+    friend class PhysicsWorld;
+public:
+    void reserve(size_t bodiesCount);
+    void clear();
+
+    uint64_t getStepIndex() const;
+    uint32_t getBodiesCount() const;
+    const uint8_t *getData() const;
+    size_t getDataSize() const;
+    bool isEmpty() const;
+
+private:
+    struct Header {
+        uint64_t stepIndex;
+        uint32_t bodiesCount;
+        uint32_t reserved;
+    };
+
+    struct BodyState {
+        uint32_t id;
+        float position[2];
+        float angle;
+        float linearVelocity[2];
+        float angularVelocity;
+        uint32_t flags;
+    };
+
+    static const uint32_t FLAG_AWAKE = 1;
+
+    void mResize(size_t bodiesCount);
+    Header &mGetHeader();
+    const Header &mGetHeader() const;
+    BodyState *mGetBodies();
+    const BodyState *mGetBodies() const;
+
+    std::vector<uint8_t> mData;
+    size_t mSize = 0;
+};
+
+// Last N snapshots, the oldest one is overwritten when the ring is full
+class PhysicsSnapshotRing {
+public:
+    explicit PhysicsSnapshotRing(size_t capacity, size_t bodiesCount = 0);
+
+    PhysicsSnapshot &push();
+    void clear();
+
+    const PhysicsSnapshot *find(uint64_t stepIndex) const;
+    const PhysicsSnapshot *getLatest() const;
+    size_t getCapacity() const;
+    size_t getSize() const;
+
+private:
+    std::vector<PhysicsSnapshot> mSnapshots;
+    size_t mNext = 0;
+    size_t mSize = 0;
+};
+
+}
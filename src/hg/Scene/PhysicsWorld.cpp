@@ -1,6 +1,12 @@
 #include "PhysicsWorld.hpp"
 #include "RigidBody.hpp"
 #include "GameObject.hpp"
+#include "../Core/Profiler.hpp"
+#include "../Core/MemoryTracker.hpp"
+#include "../Core/ThreadPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
 
 namespace hg {
 
@@ -12,40 +18,464 @@ static glm::vec2 fromBox2D(const b2Vec2 &v) {
     return glm::vec2(v.x, v.y);
 }
 
-PhysicsWorld::PhysicsWorld() : mWorld(b2Vec2(0, 0)) {
+// Every existing world and the ones stepped ahead in the current frame. Main thread only
+static std::vector<PhysicsWorld*> gWorlds;
+static std::vector<PhysicsWorld*> gSteppedWorlds;
+
+static RigidBody *getRigidBody(b2Fixture *fixture) {
+    return static_cast<RigidBody*>(fixture->GetBody()->GetUserData());
+}
+
+static bool isMatchingMask(b2Fixture *fixture, uint16_t maskBits) {
+    return (fixture->GetFilterData().categoryBits & maskBits) != 0;
+}
+
+class ClosestRayCastCallback : public b2RayCastCallback {
+public:
+    ClosestRayCastCallback(uint16_t maskBits, PhysicsRayHit &hit) : mMaskBits(maskBits), mHit(hit) {}
+
+    float32 ReportFixture(b2Fixture *fixture, const b2Vec2 &point, const b2Vec2 &normal, float32 fraction) override {
+        if (fixture->IsSensor() || !isMatchingMask(fixture, mMaskBits)) {
+            return -1.0f;
+        }
+        mHit.isHit = true;
+        mHit.body = getRigidBody(fixture);
+        mHit.point = fromBox2D(point);
+        mHit.normal = fromBox2D(normal);
+        mHit.fraction = fraction;
+        return fraction;
+    }
+
+private:
+    uint16_t mMaskBits;
+    PhysicsRayHit &mHit;
+};
+
+// Collects each matching body once. With a shape, fixtures must also overlap it, not only its AABB
+class CollectQueryCallback : public b2QueryCallback {
+public:
+    CollectQueryCallback(uint16_t maskBits, const b2Shape *shape, const b2Transform &transform, std::vector<RigidBody*> &bodies)
+        : mMaskBits(maskBits), mShape(shape), mTransform(transform), mBodies(bodies), mOffset(bodies.size()) {}
+
+    bool ReportFixture(b2Fixture *fixture) override {
+        if (!isMatchingMask(fixture, mMaskBits) || (mShape && !mIsOverlapping(fixture))) {
+            return true;
+        }
+        RigidBody *body = getRigidBody(fixture);
+        if (body && std::find(mBodies.begin() + mOffset, mBodies.end(), body) == mBodies.end()) {
+            mBodies.push_back(body);
+        }
+        return true;
+    }
+
+private:
+    bool mIsOverlapping(b2Fixture *fixture) const {
+        const b2Shape *shape = fixture->GetShape();
+        for (int32 i = 0; i < shape->GetChildCount(); i++) {
+            if (b2TestOverlap(mShape, 0, shape, i, mTransform, fixture->GetBody()->GetTransform())) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint16_t mMaskBits;
+    const b2Shape *mShape;
+    b2Transform mTransform;
+    std::vector<RigidBody*> &mBodies;
+    size_t mOffset;
+};
+
+// Runs queries in batches on the ThreadPool, each batch fills its own buffer, then they are concatenated in query order
+template<typename Query, typename Func>
+static void runCollectQueries(const std::vector<Query> &queries, PhysicsQueryResults &results, const Func &func) {
+    results.ranges.resize(queries.size());
+    results.bodies.clear();
+
+    std::mutex batchesMutex;
+    std::vector<std::pair<size_t, std::vector<RigidBody*>>> batches;
+    ThreadPool::get().parallelFor(queries.size(), 16, [&](size_t begin, size_t end) {
+        std::vector<RigidBody*> bodies;
+        for (size_t i = begin; i < end; i++) {
+            size_t offset = bodies.size();
+            func(queries[i], bodies);
+            results.ranges[i].offset = static_cast<uint32_t>(offset);
+            results.ranges[i].count = static_cast<uint32_t>(bodies.size() - offset);
+        }
+        std::lock_guard<std::mutex> lock(batchesMutex);
+        batches.push_back(std::make_pair(begin, std::move(bodies)));
+    });
+
+    std::sort(batches.begin(), batches.end(), [](const auto &a, const auto &b) {
+        return a.first < b.first;
+    });
+    for (size_t i = 0; i < batches.size(); i++) {
+        size_t end = i + 1 < batches.size() ? batches[i + 1].first : queries.size();
+        uint32_t base = static_cast<uint32_t>(results.bodies.size());
+        for (size_t j = batches[i].first; j < end; j++) {
+            results.ranges[j].offset += base;
+        }
+        results.bodies.insert(results.bodies.end(), batches[i].second.begin(), batches[i].second.end());
+    }
+}
+
+PhysicsWorld::ContactListener::ContactListener(PhysicsWorld &world) : mWorld(world) {
+}
+
+void PhysicsWorld::ContactListener::BeginContact(b2Contact *contact) {
+    mWorld.mRecordContact(ContactEventType::Begin, contact);
+}
+
+void PhysicsWorld::ContactListener::EndContact(b2Contact *contact) {
+    mWorld.mRecordContact(ContactEventType::End, contact);
+}
+
+void PhysicsWorld::ContactListener::PreSolve(b2Contact *contact, const b2Manifold *oldManifold) {
+    mWorld.mRecordContact(ContactEventType::PreSolve, contact);
+}
+
+PhysicsWorld::PhysicsWorld() : mWorld(b2Vec2(0, 0)), mContactListener(*this) {
+    mWorld.SetContactListener(&mContactListener);
+    mContactRecords.reserve(1024);
+    gWorlds.push_back(this);
+}
+
+PhysicsWorld::~PhysicsWorld() {
+    gWorlds.erase(std::find(gWorlds.begin(), gWorlds.end(), this));
 }
 
 void PhysicsWorld::onSaveLoad(hd::JSON& data, bool isLoad) {
     hd::JSON &gravity = data["gravity"];
+    hd::JSON &stepRate = data["stepRate"];
+    hd::JSON &velocityIterations = data["velocityIterations"];
+    hd::JSON &positionIterations = data["positionIterations"];
+    hd::JSON &maxSubSteps = data["maxSubSteps"];
+    hd::JSON &deterministic = data["isDeterministic"];
     if (isLoad) {
         setGravity(gravity.get<glm::vec2>());
+        // Scenes saved before these settings existed keep the defaults
+        if (!stepRate.is_null()) {
+            setStepRate(stepRate.get<float>());
+        }
+        if (!velocityIterations.is_null()) {
+            setVelocityIterations(velocityIterations.get<int32_t>());
+        }
+        if (!positionIterations.is_null()) {
+            setPositionIterations(positionIterations.get<int32_t>());
+        }
+        if (!maxSubSteps.is_null()) {
+            setMaxSubSteps(maxSubSteps.get<uint32_t>());
+        }
+        if (!deterministic.is_null()) {
+            setDeterministic(deterministic.get<bool>());
+        }
     }
     else {
         gravity = getGravity();
+        stepRate = getStepRate();
+        velocityIterations = getVelocityIterations();
+        positionIterations = getPositionIterations();
+        maxSubSteps = getMaxSubSteps();
+        deterministic = isDeterministic();
     }
 }
 
 void PhysicsWorld::onUpdate(float dt) {
-    mWorld.Step(1.0f / 60.0f, 6, 2);
+    HG_PROFILE_SCOPE("PhysicsWorld::onUpdate");
+    HG_MEMORY_TAG(MemoryTag::Physics);
 
-    if (mIsRigidBodiesDirty) {
-        mIsRigidBodiesDirty = false;
-        std::sort(mRigidBodies.begin(), mRigidBodies.end(), [](const std::pair<int, RigidBody*> &a, const std::pair<int, RigidBody*> &b) {
-            return a.first < b.first;
-        });
+    // Worlds are usually stepped ahead by the Scene, the ones created since or updated outside of it step here
+    if (!mIsSteppedAhead) {
+        mStep(dt);
     }
+    mIsSteppedAhead = false;
 
     mIsApplyingTransformsToOwners = true;
-    for (auto &[depth, body] : mRigidBodies) {
-        body->mApplyTransformToOwner();
+    for (auto &bodies : mAwakeBodiesByDepth) {
+        for (size_t i = 0; i < bodies.size();) {
+            RigidBody *body = bodies[i];
+            body->mApplyTransformToOwner(mInterpolationAlpha);
+            const b2Body *b = body->mBody;
+            if (body->mIsOwnerSynced && (b->GetType() == b2_staticBody || !b->IsAwake() || !b->IsActive())) {
+                mUntrackAwakeBody(body); // the last one takes its place
+            }
+            else {
+                i++;
+            }
+        }
     }
     mIsApplyingTransformsToOwners = false;
+
+    mDispatchContacts();
+}
+
+void PhysicsWorld::rayCast(const std::vector<PhysicsRayQuery> &queries, std::vector<PhysicsRayHit> &hits) const {
+    HG_PROFILE_SCOPE("PhysicsWorld::rayCast");
+    hits.assign(queries.size(), PhysicsRayHit());
+    ThreadPool::get().parallelFor(queries.size(), 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const PhysicsRayQuery &query = queries[i];
+            if (query.from != query.to) {
+                ClosestRayCastCallback callback(query.maskBits, hits[i]);
+                mWorld.RayCast(&callback, toBox2D(query.from), toBox2D(query.to));
+            }
+        }
+    });
+}
+
+void PhysicsWorld::queryAABB(const std::vector<PhysicsAABBQuery> &queries, PhysicsQueryResults &results) const {
+    HG_PROFILE_SCOPE("PhysicsWorld::queryAABB");
+    runCollectQueries(queries, results, [this](const PhysicsAABBQuery &query, std::vector<RigidBody*> &bodies) {
+        b2AABB aabb;
+        aabb.lowerBound = toBox2D(query.min);
+        aabb.upperBound = toBox2D(query.max);
+        CollectQueryCallback callback(query.maskBits, nullptr, b2Transform(), bodies);
+        mWorld.QueryAABB(&callback, aabb);
+    });
+}
+
+void PhysicsWorld::queryOverlap(const std::vector<PhysicsOverlapQuery> &queries, PhysicsQueryResults &results) const {
+    HG_PROFILE_SCOPE("PhysicsWorld::queryOverlap");
+    runCollectQueries(queries, results, [this](const PhysicsOverlapQuery &query, std::vector<RigidBody*> &bodies) {
+        b2PolygonShape polygon;
+        b2CircleShape circle;
+        const b2Shape *shape = nullptr;
+        switch (query.shape.type) {
+            case ColliderShapeType::Box: {
+                polygon.SetAsBox(query.shape.halfSize.x, query.shape.halfSize.y, toBox2D(query.shape.offset), query.shape.angle);
+                shape = &polygon;
+                break;
+            }
+            case ColliderShapeType::Circle: {
+                circle.m_p = toBox2D(query.shape.offset);
+                circle.m_radius = query.shape.radius;
+                shape = &circle;
+                break;
+            }
+            case ColliderShapeType::Polygon: {
+                if (query.shape.points.size() < 3 || query.shape.points.size() > b2_maxPolygonVertices) {
+                    return;
+                }
+                b2Vec2 vertices[b2_maxPolygonVertices];
+                for (size_t i = 0; i < query.shape.points.size(); i++) {
+                    vertices[i] = toBox2D(query.shape.points[i] + query.shape.offset);
+                }
+                polygon.Set(vertices, static_cast<int32>(query.shape.points.size()));
+                shape = &polygon;
+                break;
+            }
+            case ColliderShapeType::Chain: {
+                return;
+            }
+        }
+
+        b2Transform transform(toBox2D(query.position), b2Rot(query.angle));
+        b2AABB aabb;
+        shape->ComputeAABB(&aabb, transform, 0);
+        CollectQueryCallback callback(query.maskBits, shape, transform, bodies);
+        mWorld.QueryAABB(&callback, aabb);
+    });
+}
+
+void PhysicsWorld::saveSnapshot(PhysicsSnapshot &snapshot) const {
+    HG_PROFILE_SCOPE("PhysicsWorld::saveSnapshot");
+    size_t bodiesCount = 0;
+    for (auto &bodies : mRigidBodiesByDepth) {
+        bodiesCount += bodies.size();
+    }
+
+    snapshot.mResize(bodiesCount);
+    PhysicsSnapshot::Header &header = snapshot.mGetHeader();
+    header.stepIndex = mStepIndex;
+    header.bodiesCount = static_cast<uint32_t>(bodiesCount);
+    header.reserved = 0;
+
+    PhysicsSnapshot::BodyState *state = snapshot.mGetBodies();
+    for (auto &bodies : mRigidBodiesByDepth) {
+        for (auto &body : bodies) {
+            const b2Body *b = body->mBody;
+            state->id = body->mIdInWorld;
+            state->position[0] = b->GetPosition().x;
+            state->position[1] = b->GetPosition().y;
+            state->angle = b->GetAngle();
+            state->linearVelocity[0] = b->GetLinearVelocity().x;
+            state->linearVelocity[1] = b->GetLinearVelocity().y;
+            state->angularVelocity = b->GetAngularVelocity();
+            state->flags = b->IsAwake() ? PhysicsSnapshot::FLAG_AWAKE : 0;
+            state++;
+        }
+    }
+}
+
+bool PhysicsWorld::restoreSnapshot(const PhysicsSnapshot &snapshot) {
+    HG_PROFILE_SCOPE("PhysicsWorld::restoreSnapshot");
+    if (mIsStepping) {
+        HD_LOG_FATAL("Physics snapshot can't be restored during the step");
+    }
+    if (snapshot.isEmpty()) {
+        return false;
+    }
+
+    std::vector<TouchingPair> touchingPairs;
+    if (mIsDeterministic) {
+        mCollectTouchingPairs(touchingPairs);
+    }
+
+    // Bodies are saved in the iteration order, which holds until a body is created or destroyed.
+    // Only the bodies out of that order are searched for
+    const PhysicsSnapshot::Header &header = snapshot.mGetHeader();
+    const PhysicsSnapshot::BodyState *states = snapshot.mGetBodies();
+    uint32_t restoredCount = 0;
+    uint32_t bodiesCount = 0;
+    for (auto &bodies : mRigidBodiesByDepth) {
+        bodiesCount += static_cast<uint32_t>(bodies.size());
+    }
+
+    uint32_t stateIndex = 0;
+    for (auto &bodies : mRigidBodiesByDepth) {
+        for (auto &body : bodies) {
+            const PhysicsSnapshot::BodyState *state = nullptr;
+            if (stateIndex < header.bodiesCount && states[stateIndex].id == body->mIdInWorld) {
+                state = &states[stateIndex++];
+            }
+            else {
+                for (uint32_t i = 0; i < header.bodiesCount; i++) {
+                    if (states[i].id == body->mIdInWorld) {
+                        state = &states[i];
+                        stateIndex = i + 1;
+                        break;
+                    }
+                }
+            }
+            if (!state) {
+                continue;
+            }
+
+            b2Body *b = body->mBody;
+            b->SetTransform(b2Vec2(state->position[0], state->position[1]), state->angle);
+            b->SetLinearVelocity(b2Vec2(state->linearVelocity[0], state->linearVelocity[1]));
+            b->SetAngularVelocity(state->angularVelocity);
+            b->SetAwake((state->flags & PhysicsSnapshot::FLAG_AWAKE) != 0);
+            body->mSavePreviousTransform(); // teleported, nothing to interpolate from
+            body->mIsOwnerSynced = false;
+            mTrackAwakeBody(body);
+            restoredCount++;
+        }
+    }
+    mStepIndex = header.stepIndex;
+
+    // The contacts are recreated, the next step would report every touching pair again otherwise
+    if (mIsDeterministic) {
+        std::vector<TouchingPair> restoredTouchingPairs;
+        mResetContacts();
+        mCollectTouchingPairs(restoredTouchingPairs);
+        mRecordTouchingChanges(touchingPairs, restoredTouchingPairs);
+    }
+    return restoredCount == header.bodiesCount && restoredCount == bodiesCount;
+}
+
+void PhysicsWorld::simulate(uint32_t stepsCount) {
+    HG_PROFILE_SCOPE("PhysicsWorld::simulate");
+    HG_MEMORY_TAG(MemoryTag::Physics);
+    mIsStepping = true;
+    for (uint32_t i = 0; i < stepsCount; i++) {
+        mFixedStep(i + 1 == stepsCount);
+    }
+    mIsStepping = false;
+    mCollectWokenBodies();
+}
+
+bool PhysicsWorld::rollback(const PhysicsSnapshotRing &ring, uint64_t stepIndex, const std::function<void(uint64_t stepIndex)> &beforeStep) {
+    HG_PROFILE_SCOPE("PhysicsWorld::rollback");
+    const PhysicsSnapshot *snapshot = ring.find(stepIndex);
+    if (!snapshot || stepIndex > mStepIndex) {
+        return false;
+    }
+
+    // Events of the resimulated steps are replaced by the net change of touching pairs,
+    // so listeners end up with the touching state of the new timeline
+    uint64_t targetStepIndex = mStepIndex;
+    size_t contactRecordsCount = mContactRecords.size();
+    std::vector<TouchingPair> touchingPairs;
+    std::vector<TouchingPair> resimulatedTouchingPairs;
+    mCollectTouchingPairs(touchingPairs);
+    bool isRestored = restoreSnapshot(*snapshot);
+    if (beforeStep) {
+        while (mStepIndex < targetStepIndex) {
+            beforeStep(mStepIndex);
+            simulate(1);
+        }
+    }
+    else {
+        simulate(static_cast<uint32_t>(targetStepIndex - mStepIndex));
+    }
+    mClearContactRecords(contactRecordsCount);
+    mCollectTouchingPairs(resimulatedTouchingPairs);
+    mRecordTouchingChanges(touchingPairs, resimulatedTouchingPairs);
+    return isRestored;
 }
 
 void PhysicsWorld::setGravity(const glm::vec2 &gravity) {
     mWorld.SetGravity(toBox2D(gravity));
 }
 
+void PhysicsWorld::setStepRate(float stepRate) {
+    if (!(stepRate > 0.0f) || std::isinf(stepRate)) {
+        HD_LOG_ERROR("Invalid physics step rate {}", stepRate);
+        return;
+    }
+    mStepRate = stepRate;
+}
+
+void PhysicsWorld::setVelocityIterations(int32_t iterations) {
+    mVelocityIterations = std::max(iterations, 1);
+}
+
+void PhysicsWorld::setPositionIterations(int32_t iterations) {
+    mPositionIterations = std::max(iterations, 1);
+}
+
+void PhysicsWorld::setMaxSubSteps(uint32_t maxSubSteps) {
+    mMaxSubSteps = std::max(maxSubSteps, 1u);
+}
+
+void PhysicsWorld::setDeterministic(bool deterministic) {
+    // Warm starting impulses and sleep timers aren't part of snapshots, so they are disabled
+    // to get the same result when resimulating from a restored state
+    mIsDeterministic = deterministic;
+    mWorld.SetWarmStarting(!deterministic);
+    mWorld.SetAllowSleeping(!deterministic);
+}
+
+void PhysicsWorld::stepWorlds(float dt) {
+    HG_PROFILE_SCOPE("PhysicsWorld::stepWorlds");
+    // Worlds share nothing, so they are stepped in parallel. Flags left by worlds which weren't updated
+    // in the previous frame are dropped here, so they are stepped again
+    gSteppedWorlds.clear();
+    for (PhysicsWorld *world : gWorlds) {
+        world->mIsSteppedAhead = false;
+        if (world->mIsUpdatedInHierarchy()) {
+            gSteppedWorlds.push_back(world);
+        }
+    }
+    ThreadPool::get().parallelFor(gSteppedWorlds.size(), 1, [dt](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            gSteppedWorlds[i]->mStep(dt);
+            gSteppedWorlds[i]->mIsSteppedAhead = true;
+        }
+    });
+}
+
+PhysicsWorld *PhysicsWorld::findNearest(GameObject *go) {
+    for (; go; go = go->getParent()) {
+        PhysicsWorld *world = go->findComponent<PhysicsWorld>();
+        if (world) {
+            return world;
+        }
+    }
+    return nullptr;
+}
+
 b2World &PhysicsWorld::getWorld() {
     return mWorld;
 }
@@ -54,27 +484,373 @@ glm::vec2 PhysicsWorld::getGravity() const {
     return fromBox2D(mWorld.GetGravity());
 }
 
+float PhysicsWorld::getStepRate() const {
+    return mStepRate;
+}
+
+float PhysicsWorld::getStepTime() const {
+    return 1.0f / mStepRate;
+}
+
+int32_t PhysicsWorld::getVelocityIterations() const {
+    return mVelocityIterations;
+}
+
+int32_t PhysicsWorld::getPositionIterations() const {
+    return mPositionIterations;
+}
+
+uint32_t PhysicsWorld::getMaxSubSteps() const {
+    return mMaxSubSteps;
+}
+
+bool PhysicsWorld::isDeterministic() const {
+    return mIsDeterministic;
+}
+
+uint64_t PhysicsWorld::getStepIndex() const {
+    return mStepIndex;
+}
+
+float PhysicsWorld::getInterpolationAlpha() const {
+    return mInterpolationAlpha;
+}
+
 bool PhysicsWorld::isApplyingTransformsToOwners() const {
     return mIsApplyingTransformsToOwners;
 }
 
+void PhysicsWorld::mStep(float dt) {
+    HG_PROFILE_SCOPE("PhysicsWorld::step");
+    HG_MEMORY_TAG(MemoryTag::Physics);
+
+    // Fixed steps catch up with real time, the backlog beyond mMaxSubSteps is dropped to avoid the spiral of death.
+    // Deterministic worlds keep it for the next frames instead, so the step index always follows the elapsed time
+    const float stepTime = getStepTime();
+    mTimeAccumulator += dt;
+    uint32_t stepsCount = std::min(static_cast<uint32_t>(mTimeAccumulator / stepTime), mMaxSubSteps);
+    mIsStepping = true;
+    for (uint32_t i = 0; i < stepsCount; i++) {
+        mFixedStep(i + 1 == stepsCount);
+        mTimeAccumulator -= stepTime;
+    }
+    mIsStepping = false;
+    if (stepsCount != 0) {
+        mCollectWokenBodies();
+    }
+    if (!mIsDeterministic && mTimeAccumulator >= stepTime) {
+        mTimeAccumulator = std::fmod(mTimeAccumulator, stepTime);
+    }
+    mInterpolationAlpha = std::min(mTimeAccumulator / stepTime, 1.0f);
+}
+
+void PhysicsWorld::mFixedStep(bool isLastStep) {
+    if (isLastStep) {
+        // Owners are interpolated between the last two steps
+        for (auto &bodies : mAwakeBodiesByDepth) {
+            for (auto &body : bodies) {
+                body->mSavePreviousTransform();
+            }
+        }
+    }
+    mWorld.Step(getStepTime(), mVelocityIterations, mPositionIterations);
+    mStepIndex++;
+}
+
+bool PhysicsWorld::mIsUpdatedInHierarchy() const {
+    if (isPendingDestroy()) {
+        return false;
+    }
+    for (GameObject *go = getOwner(); go; go = go->getParent()) {
+        if (!go->isActive() || go->isPendingDestroy()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void PhysicsWorld::mAddRigidBody(RigidBody *body) {
-    int goDepth = 0;
+    // GameObjects can't be reparented, so the depth never changes while the body lives
+    size_t goDepth = 0;
     GameObject *go = body->getOwner()->getParent();
     while (go) {
         goDepth++;
         go = go->getParent();
     }
 
-    mRigidBodies.push_back(std::make_pair(goDepth, body));
-    mIsRigidBodiesDirty = true;
+    if (goDepth >= mRigidBodiesByDepth.size()) {
+        mRigidBodiesByDepth.resize(goDepth + 1);
+        mAwakeBodiesByDepth.resize(goDepth + 1);
+    }
+    std::vector<RigidBody*> &bodies = mRigidBodiesByDepth[goDepth];
+    body->mDepthInWorld = goDepth;
+    body->mIndexInWorld = bodies.size();
+    body->mIdInWorld = mNextBodyId++;
+    bodies.push_back(body);
+    mTrackAwakeBody(body);
 }
 
 void PhysicsWorld::mRemoveRigidBody(RigidBody *body) {
-    auto it = std::find_if(mRigidBodies.begin(), mRigidBodies.end(), [&](const std::pair<int, RigidBody*> &p) {
-        return p.second == body;
-    });
-    mRigidBodies.erase(it);
+    // Order inside one depth doesn't matter, so swap with the last one
+    std::vector<RigidBody*> &bodies = mRigidBodiesByDepth[body->mDepthInWorld];
+    bodies[body->mIndexInWorld] = bodies.back();
+    bodies[body->mIndexInWorld]->mIndexInWorld = body->mIndexInWorld;
+    bodies.pop_back();
+    if (body->mIsAwakeTracked) {
+        mUntrackAwakeBody(body);
+    }
+
+    // Records wait for the owner's update or the next one, a removed body must not be delivered to or reported
+    if (body->mPendingContactsCount > 0) {
+        mDropPendingContacts(body);
+    }
+}
+
+void PhysicsWorld::mDropPendingContacts(RigidBody *body) {
+    for (auto &record : mContactRecords) {
+        if (record.bodyA == body || record.bodyB == body) {
+            record.isDeliveredToA = false;
+            record.isDeliveredToB = false;
+            record.bodyA = record.bodyA == body ? nullptr : record.bodyA;
+            record.bodyB = record.bodyB == body ? nullptr : record.bodyB;
+        }
+    }
+    body->mPendingContactsCount = 0;
+}
+
+void PhysicsWorld::mClearContactRecords(size_t count) {
+    for (size_t i = count; i < mContactRecords.size(); i++) {
+        const ContactRecord &record = mContactRecords[i];
+        if (record.bodyA) {
+            record.bodyA->mPendingContactsCount--;
+        }
+        if (record.bodyB) {
+            record.bodyB->mPendingContactsCount--;
+        }
+    }
+    mContactRecords.resize(count);
+}
+
+void PhysicsWorld::mTrackAwakeBody(RigidBody *body) {
+    if (body->mIsAwakeTracked) {
+        return;
+    }
+    // Untracked bodies haven't moved since their owners were synced, so there is nothing to interpolate from
+    body->mSavePreviousTransform();
+    std::vector<RigidBody*> &bodies = mAwakeBodiesByDepth[body->mDepthInWorld];
+    body->mIsAwakeTracked = true;
+    body->mIndexInAwakeList = bodies.size();
+    bodies.push_back(body);
+}
+
+void PhysicsWorld::mUntrackAwakeBody(RigidBody *body) {
+    std::vector<RigidBody*> &bodies = mAwakeBodiesByDepth[body->mDepthInWorld];
+    bodies[body->mIndexInAwakeList] = bodies.back();
+    bodies[body->mIndexInAwakeList]->mIndexInAwakeList = body->mIndexInAwakeList;
+    bodies.pop_back();
+    body->mIsAwakeTracked = false;
+}
+
+void PhysicsWorld::mCollectWokenBodies() {
+    // Box2D wakes sleeping bodies touching awake ones inside the step without telling anyone.
+    // They are found through the contacts of the tracked bodies, so the cost follows the awake part of the world
+    mWokenBodies.clear();
+    for (auto &bodies : mAwakeBodiesByDepth) {
+        for (size_t i = 0, count = bodies.size(); i < count; i++) {
+            mTrackTouchingBodies(bodies[i]);
+        }
+    }
+    for (size_t i = 0; i < mWokenBodies.size(); i++) {
+        mTrackTouchingBodies(mWokenBodies[i]);
+    }
+}
+
+void PhysicsWorld::mTrackTouchingBodies(RigidBody *body) {
+    if (!body->mBody->IsAwake()) {
+        return;
+    }
+    for (b2ContactEdge *edge = body->mBody->GetContactList(); edge; edge = edge->next) {
+        RigidBody *other = static_cast<RigidBody*>(edge->other->GetUserData());
+        if (other && !other->mIsAwakeTracked && other->mBody->IsAwake() && edge->contact->IsTouching()) {
+            mTrackAwakeBody(other);
+            mWokenBodies.push_back(other);
+        }
+    }
+}
+
+void PhysicsWorld::mResetContacts() {
+    HG_PROFILE_SCOPE("PhysicsWorld::resetContacts");
+    // Box2D keeps contacts and fat AABBs from the past steps, and the order of contacts decides the solver order.
+    // Recreating the proxies drops both. Deactivating in reverse and activating in order reverses the proxy ids
+    // within each body, so it's done twice and every proxy keeps its id
+    std::vector<b2Body*> bodies;
+    for (b2Body *body = mWorld.GetBodyList(); body; body = body->GetNext()) {
+        if (body->IsActive()) {
+            bodies.push_back(body);
+        }
+    }
+    for (int i = 0; i < 2; i++) {
+        for (size_t j = bodies.size(); j > 0; j--) {
+            bodies[j - 1]->SetActive(false);
+        }
+        for (b2Body *body : bodies) {
+            body->SetActive(true);
+        }
+    }
+
+    // Box2D only looks for new contacts at the start of a step after a fixture was created.
+    // The zero step finds them and their touching state without moving anything, the listener ignores it
+    b2BodyDef bodyDef;
+    b2CircleShape shape;
+    shape.m_radius = b2_linearSlop;
+    b2FixtureDef fixtureDef;
+    fixtureDef.shape = &shape;
+    b2Body *body = mWorld.CreateBody(&bodyDef);
+    body->CreateFixture(&fixtureDef);
+    mWorld.DestroyBody(body);
+    mWorld.Step(0.0f, 0, 0);
+}
+
+void PhysicsWorld::mCollectTouchingPairs(std::vector<TouchingPair> &pairs) {
+    // Contacts between two bodies which don't move aren't updated by Box2D, so they are left out
+    pairs.clear();
+    for (b2Contact *contact = mWorld.GetContactList(); contact; contact = contact->GetNext()) {
+        const b2Body *bodyA = contact->GetFixtureA()->GetBody();
+        const b2Body *bodyB = contact->GetFixtureB()->GetBody();
+        bool isUpdated = (bodyA->IsAwake() && bodyA->GetType() != b2_staticBody) || (bodyB->IsAwake() && bodyB->GetType() != b2_staticBody);
+        if (!contact->IsTouching() || !isUpdated) {
+            continue;
+        }
+        TouchingPair pair;
+        pair.fixtureA = contact->GetFixtureA();
+        pair.fixtureB = contact->GetFixtureB();
+        pair.childIndexA = contact->GetChildIndexA();
+        pair.childIndexB = contact->GetChildIndexB();
+        pair.contact = contact;
+        if (std::less<b2Fixture*>()(pair.fixtureB, pair.fixtureA)) {
+            std::swap(pair.fixtureA, pair.fixtureB);
+            std::swap(pair.childIndexA, pair.childIndexB);
+        }
+        pairs.push_back(pair);
+    }
+    std::sort(pairs.begin(), pairs.end(), mIsLessTouchingPair);
+}
+
+// Pairs which stopped touching get End without points, new ones Begin. Contacts of the old pairs may be gone already
+void PhysicsWorld::mRecordTouchingChanges(const std::vector<TouchingPair> &oldPairs, const std::vector<TouchingPair> &newPairs) {
+    size_t oldIndex = 0;
+    size_t newIndex = 0;
+    while (oldIndex < oldPairs.size() || newIndex < newPairs.size()) {
+        if (newIndex == newPairs.size() || (oldIndex < oldPairs.size() && mIsLessTouchingPair(oldPairs[oldIndex], newPairs[newIndex]))) {
+            const TouchingPair &pair = oldPairs[oldIndex++];
+            mRecordContact(ContactEventType::End, pair.fixtureA, pair.fixtureB, nullptr);
+        }
+        else if (oldIndex == oldPairs.size() || mIsLessTouchingPair(newPairs[newIndex], oldPairs[oldIndex])) {
+            const TouchingPair &pair = newPairs[newIndex++];
+            mRecordContact(ContactEventType::Begin, pair.fixtureA, pair.fixtureB, pair.contact);
+        }
+        else {
+            oldIndex++;
+            newIndex++;
+        }
+    }
+}
+
+bool PhysicsWorld::mIsLessTouchingPair(const TouchingPair &a, const TouchingPair &b) {
+    std::less<b2Fixture*> isLess;
+    if (a.fixtureA != b.fixtureA) {
+        return isLess(a.fixtureA, b.fixtureA);
+    }
+    if (a.fixtureB != b.fixtureB) {
+        return isLess(a.fixtureB, b.fixtureB);
+    }
+    if (a.childIndexA != b.childIndexA) {
+        return a.childIndexA < b.childIndexA;
+    }
+    return a.childIndexB < b.childIndexB;
+}
+
+void PhysicsWorld::mRecordContact(ContactEventType type, b2Contact *contact) {
+    // Contacts destroyed outside of the step (by DestroyBody, DestroyFixture, filter changes) aren't reported
+    if (mIsStepping) {
+        mRecordContact(type, contact->GetFixtureA(), contact->GetFixtureB(), contact);
+    }
+}
+
+// Without the contact, as for pairs which stopped touching over a restore, the record has no points
+void PhysicsWorld::mRecordContact(ContactEventType type, b2Fixture *fixtureA, b2Fixture *fixtureB, b2Contact *contact) {
+    RigidBody *bodyA = getRigidBody(fixtureA);
+    RigidBody *bodyB = getRigidBody(fixtureB);
+    bool isPreSolve = type == ContactEventType::PreSolve;
+    ContactRecord record;
+    record.type = type;
+    record.bodyA = bodyA;
+    record.bodyB = bodyB;
+    record.isDeliveredToA = bodyA && (bodyA->mContactEventMask & fixtureB->GetFilterData().categoryBits) && (!isPreSolve || bodyA->mIsPreSolveEventsEnabled);
+    record.isDeliveredToB = bodyB && (bodyB->mContactEventMask & fixtureA->GetFilterData().categoryBits) && (!isPreSolve || bodyB->mIsPreSolveEventsEnabled);
+    if (!record.isDeliveredToA && !record.isDeliveredToB) {
+        return;
+    }
+    record.isSensor = fixtureA->IsSensor() || fixtureB->IsSensor();
+    record.normal = glm::vec2(0, 0);
+    record.point = glm::vec2(0, 0);
+    record.pointCount = 0;
+    if (!record.isSensor && type != ContactEventType::End && contact) {
+        record.pointCount = contact->GetManifold()->pointCount;
+        if (record.pointCount > 0) {
+            b2WorldManifold worldManifold;
+            contact->GetWorldManifold(&worldManifold);
+            record.normal = fromBox2D(worldManifold.normal);
+            record.point = fromBox2D(worldManifold.points[0]);
+        }
+    }
+    mContactRecords.push_back(record);
+    if (bodyA) {
+        bodyA->mPendingContactsCount++;
+    }
+    if (bodyB) {
+        bodyB->mPendingContactsCount++;
+    }
+}
+
+void PhysicsWorld::mDispatchContacts() {
+    HG_PROFILE_SCOPE("PhysicsWorld::dispatchContacts");
+    mIsDispatchingContacts = true;
+    // Handlers may destroy bodies, their remaining records are cleared then
+    for (const auto &record : mContactRecords) {
+        if (record.isDeliveredToA) {
+            mDeliverContact(record, record.bodyA, record.bodyB, record.normal);
+        }
+        if (record.isDeliveredToB) {
+            mDeliverContact(record, record.bodyB, record.bodyA, -record.normal);
+        }
+    }
+    mClearContactRecords(0);
+    mIsDispatchingContacts = false;
+}
+
+void PhysicsWorld::mDeliverContact(const ContactRecord &record, RigidBody *body, RigidBody *otherBody, const glm::vec2 &normal) {
+    ContactEvent event;
+    event.type = record.type;
+    event.otherBody = otherBody;
+    event.isSensor = record.isSensor;
+    event.normal = normal;
+    event.point = record.point;
+    event.pointCount = record.pointCount;
+    switch (record.type) {
+        case ContactEventType::Begin: {
+            body->onContactBegin(event);
+            break;
+        }
+        case ContactEventType::End: {
+            body->onContactEnd(event);
+            break;
+        }
+        case ContactEventType::PreSolve: {
+            body->onContactPreSolve(event);
+            break;
+        }
+    }
 }
 
 }
@@ -1,35 +1,186 @@
 #pragma once
 #include "Component.hpp"
+#include "RigidBody.hpp"
+#include "PhysicsSnapshot.hpp"
 #include "glm/glm.hpp"
 #include "Box2D/Box2D.h"
+#include <functional>
 
 namespace hg {
 
-class RigidBody;
+// Fixtures are matched when (categoryBits & maskBits) != 0
+struct PhysicsRayQuery {
+    glm::vec2 from = glm::vec2(0, 0);
+    glm::vec2 to = glm::vec2(0, 0);
+    uint16_t maskBits = 0xFFFF;
+};
+
+// Closest non-sensor hit. body is nullptr for colliders without RigidBody, like Tilemap chunks
+struct PhysicsRayHit {
+    bool isHit = false;
+    RigidBody *body = nullptr;
+    glm::vec2 point = glm::vec2(0, 0);
+    glm::vec2 normal = glm::vec2(0, 0);
+    float fraction = 1.0f;
+};
+
+struct PhysicsAABBQuery {
+    glm::vec2 min = glm::vec2(0, 0);
+    glm::vec2 max = glm::vec2(0, 0);
+    uint16_t maskBits = 0xFFFF;
+};
+
+// Chain shapes can't be used for overlap tests
+struct PhysicsOverlapQuery {
+    ColliderShape shape;
+    glm::vec2 position = glm::vec2(0, 0);
+    float angle = 0.0f;
+    uint16_t maskBits = 0xFFFF;
+};
+
+struct PhysicsQueryRange {
+    uint32_t offset = 0;
+    uint32_t count = 0;
+};
+
+// Only RigidBodies are reported. Bodies found by query i are bodies[ranges[i].offset .. ranges[i].offset + ranges[i].count)
+struct PhysicsQueryResults {
+    std::vector<PhysicsQueryRange> ranges;
+    std::vector<RigidBody*> bodies;
+};
 
 class PhysicsWorld : public Component {
     HG_OBJECT(PhysicsWorld, Component);
     friend class RigidBody;
 public:
     PhysicsWorld();
+    ~PhysicsWorld();
 
     void onSaveLoad(hd::JSON &data, bool isLoad) override;
     void onUpdate(float dt) override;
 
+    // Queries run in parallel on the ThreadPool against the state after the last step.
+    // The world must not be changed until they return
+    void rayCast(const std::vector<PhysicsRayQuery> &queries, std::vector<PhysicsRayHit> &hits) const;
+    void queryAABB(const std::vector<PhysicsAABBQuery> &queries, PhysicsQueryResults &results) const;
+    void queryOverlap(const std::vector<PhysicsOverlapQuery> &queries, PhysicsQueryResults &results) const;
+
+    // Snapshots hold the bodies' state only, the world settings and shapes must match when restoring.
+    // Restoring returns false if bodies were created or destroyed since, those are left as they are.
+    // Deterministic worlds recreate their contacts on restore, so stepping from a snapshot gives the same
+    // bytes every time. The run which saved it can differ in the last bits, Box2D keeps contacts between steps
+    // which snapshots don't hold. Restore right after saving to continue from exactly the saved state
+    void saveSnapshot(PhysicsSnapshot &snapshot) const;
+    bool restoreSnapshot(const PhysicsSnapshot &snapshot);
+
+    // Runs fixed steps right away on the calling thread, contacts are dispatched with the next update
+    void simulate(uint32_t stepsCount);
+
+    // Restores the snapshot of the given step and simulates back to the current one.
+    // beforeStep is called before every step with its index, to reapply the inputs of that step.
+    // Instead of the events of the resimulated steps, Begin and End are reported for pairs whose touching changed
+    bool rollback(const PhysicsSnapshotRing &ring, uint64_t stepIndex, const std::function<void(uint64_t stepIndex)> &beforeStep = nullptr);
+
     void setGravity(const glm::vec2 &gravity);
+    void setStepRate(float stepRate);
+    void setVelocityIterations(int32_t iterations);
+    void setPositionIterations(int32_t iterations);
+    void setMaxSubSteps(uint32_t maxSubSteps);
+    void setDeterministic(bool deterministic);
+
+    // Steps every world that will be updated this frame, before the component updates.
+    // Their onUpdate then only writes back to owners and dispatches contacts
+    static void stepWorlds(float dt);
+
+    // The world a body under the given object belongs to: on the object itself or its nearest ancestor
+    static PhysicsWorld *findNearest(GameObject *go);
 
     b2World &getWorld();
     glm::vec2 getGravity() const;
+    float getStepRate() const;
+    float getStepTime() const;
+    int32_t getVelocityIterations() const;
+    int32_t getPositionIterations() const;
+    uint32_t getMaxSubSteps() const;
+    bool isDeterministic() const;
+    uint64_t getStepIndex() const;
+    float getInterpolationAlpha() const;
     bool isApplyingTransformsToOwners() const;
 
 private:
+    class ContactListener : public b2ContactListener {
+    public:
+        explicit ContactListener(PhysicsWorld &world);
+
+        void BeginContact(b2Contact *contact) override;
+        void EndContact(b2Contact *contact) override;
+        void PreSolve(b2Contact *contact, const b2Manifold *oldManifold) override;
+
+    private:
+        PhysicsWorld &mWorld;
+    };
+
+    struct TouchingPair {
+        b2Fixture *fixtureA;
+        b2Fixture *fixtureB;
+        int32_t childIndexA;
+        int32_t childIndexB;
+        b2Contact *contact;
+    };
+
+    struct ContactRecord {
+        ContactEventType type;
+        RigidBody *bodyA;
+        RigidBody *bodyB;
+        bool isDeliveredToA;
+        bool isDeliveredToB;
+        bool isSensor;
+        glm::vec2 normal;
+        glm::vec2 point;
+        int32_t pointCount;
+    };
+
+    void mStep(float dt);
+    void mFixedStep(bool isLastStep);
+    bool mIsUpdatedInHierarchy() const;
     void mAddRigidBody(RigidBody *body);
     void mRemoveRigidBody(RigidBody *body);
+    void mTrackAwakeBody(RigidBody *body);
+    void mUntrackAwakeBody(RigidBody *body);
+    void mCollectWokenBodies();
+    void mTrackTouchingBodies(RigidBody *body);
+    void mResetContacts();
+    void mCollectTouchingPairs(std::vector<TouchingPair> &pairs);
+    void mRecordTouchingChanges(const std::vector<TouchingPair> &oldPairs, const std::vector<TouchingPair> &newPairs);
+    static bool mIsLessTouchingPair(const TouchingPair &a, const TouchingPair &b);
+    void mRecordContact(ContactEventType type, b2Contact *contact);
+    void mRecordContact(ContactEventType type, b2Fixture *fixtureA, b2Fixture *fixtureB, b2Contact *contact);
+    void mDropPendingContacts(RigidBody *body);
+    void mClearContactRecords(size_t count);
+    void mDispatchContacts();
+    void mDeliverContact(const ContactRecord &record, RigidBody *body, RigidBody *otherBody, const glm::vec2 &normal);
 
     b2World mWorld;
-    std::vector<std::pair<int, RigidBody*>> mRigidBodies;
-    bool mIsRigidBodiesDirty = false;
+    std::vector<std::vector<RigidBody*>> mRigidBodiesByDepth;
+    // Bodies which can move or still have to be written back, parents before their children.
+    // Static and sleeping ones leave it once their owners have the final transform
+    std::vector<std::vector<RigidBody*>> mAwakeBodiesByDepth;
+    std::vector<RigidBody*> mWokenBodies;
     bool mIsApplyingTransformsToOwners = false;
+    float mStepRate = 60.0f;
+    int32_t mVelocityIterations = 6;
+    int32_t mPositionIterations = 2;
+    uint32_t mMaxSubSteps = 5;
+    float mTimeAccumulator = 0.0f;
+    float mInterpolationAlpha = 0.0f;
+    bool mIsDeterministic = false;
+    uint64_t mStepIndex = 0;
+    uint32_t mNextBodyId = 0;
+    ContactListener mContactListener;
+    std::vector<ContactRecord> mContactRecords; // keeps its capacity, so steady state steps don't allocate
+    bool mIsStepping = false;
+    bool mIsSteppedAhead = false;
+    bool mIsDispatchingContacts = false;
 };
 
 }
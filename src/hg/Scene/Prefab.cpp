@@ -0,0 +1,98 @@
+#include "Prefab.hpp"
+#include "../Core/BinaryArchive.hpp"
+#include "hd/IO/FileStream.hpp"
+
+namespace hg {
+
+Prefab::Prefab(const hd::JSON &data) {
+    parseNode(mRoot, data);
+}
+
+GameObject *Prefab::instantiate(GameObject *parent) const {
+    GameObject *go = parent->createChild();
+    instantiateNode(mRoot, go);
+    return go;
+}
+
+void Prefab::instantiate(GameObject *parent, size_t count, std::vector<GameObject*> &instances) const {
+    parent->mChildren.reserve(parent->mChildren.size() + count);
+    instances.reserve(instances.size() + count);
+    for (size_t i = 0; i < count; i++) {
+        instances.push_back(instantiate(parent));
+    }
+}
+
+const PrefabNode &Prefab::getRoot() const {
+    return mRoot;
+}
+
+void Prefab::parseNode(PrefabNode &node, const hd::JSON &data) {
+    node.name = data.at("name").get<std::string>();
+    node.isActive = data.at("isActive").get<bool>();
+    node.pos = data.at("position").get<glm::vec2>();
+    node.size = data.at("size").get<glm::vec2>();
+    node.angle = data.at("angle").get<float>();
+
+    auto components = data.find("components");
+    if (components != data.end()) {
+        node.components.reserve(components->size());
+        for (const auto &it : components->items()) {
+            node.components.emplace_back(hd::StringHash(it.key()), it.value());
+        }
+    }
+
+    auto children = data.find("children");
+    if (children != data.end()) {
+        node.children.resize(children->size());
+        size_t i = 0;
+        for (const auto &it : *children) {
+            parseNode(node.children[i++], it);
+        }
+    }
+}
+
+void Prefab::applyNode(const PrefabNode &node, GameObject *go) {
+    go->setName(node.name);
+    go->setActive(node.isActive);
+    go->mPos = node.pos;
+    go->mSize = node.size;
+    go->mAngle = node.angle;
+    go->mUpdateTransform();
+
+    go->mComponents.reserve(go->mComponents.size() + node.components.size());
+    for (auto &[typeHash, data] : node.components) {
+        Component *comp = go->createComponent(typeHash);
+        if (comp) {
+            comp->onSaveLoad(data, true);
+        }
+    }
+}
+
+void Prefab::instantiateNode(const PrefabNode &node, GameObject *go) {
+    applyNode(node, go);
+
+    go->mChildren.reserve(go->mChildren.size() + node.children.size());
+    for (const auto &childNode : node.children) {
+        instantiateNode(childNode, go->createChild());
+    }
+}
+
+size_t Prefab::getNodesCount(const PrefabNode &node) {
+    size_t count = 1;
+    for (const auto &child : node.children) {
+        count += getNodesCount(child);
+    }
+    return count;
+}
+
+PrefabPtr Prefab::createFromFile(const std::string &path) {
+    hd::FileStream file = hd::FileStream(GameObject::mGetFullPath(path), hd::FileMode::Read);
+    std::vector<uint8_t> buffer = file.readAllBuffer();
+    hd::JSON data;
+    if (!BinaryArchive::parse(buffer, data)) {
+        HD_LOG_FATAL("Failed to load prefab '{}'", path);
+    }
+    return std::make_shared<Prefab>(data);
+}
+
+}
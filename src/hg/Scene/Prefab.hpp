@@ -0,0 +1,41 @@
+#pragma once
+#include "GameObject.hpp"
+#include <memory>
+
+namespace hg {
+
+struct PrefabNode {
+    std::string name;
+    bool isActive = true;
+    glm::vec2 pos = glm::vec2(0, 0);
+    glm::vec2 size = glm::vec2(0, 0);
+    float angle = 0.0f;
+    // Loaded in place on every instantiation without a copy. Loading only reads values, at most adding nulls
+    // for missing keys, which read as missing again
+    mutable std::vector<std::pair<hd::StringHash, hd::JSON>> components;
+    std::vector<PrefabNode> children;
+};
+
+using PrefabPtr = std::shared_ptr<class Prefab>;
+
+class Prefab {
+public:
+    explicit Prefab(const hd::JSON &data);
+
+    GameObject *instantiate(GameObject *parent) const;
+    void instantiate(GameObject *parent, size_t count, std::vector<GameObject*> &instances) const;
+
+    const PrefabNode &getRoot() const;
+
+    static void parseNode(PrefabNode &node, const hd::JSON &data);
+    static void applyNode(const PrefabNode &node, GameObject *go);
+    static void instantiateNode(const PrefabNode &node, GameObject *go);
+    static size_t getNodesCount(const PrefabNode &node);
+
+    static PrefabPtr createFromFile(const std::string &path);
+
+private:
+    PrefabNode mRoot;
+};
+
+}
@@ -1,6 +1,7 @@
 #include "RigidBody.hpp"
 #include "PhysicsWorld.hpp"
 #include "Scene.hpp"
+#include <cmath>
 
 namespace hg {
 
@@ -14,6 +15,7 @@ static glm::vec2 fromBox2D(const b2Vec2 &v) {
 
 RigidBody::~RigidBody() {
     mWorld->mRemoveRigidBody(this);
+    mBody->SetUserData(nullptr); // contacts ended by DestroyBody aren't reported
     mWorld->getWorld().DestroyBody(mBody);
 }
 
@@ -37,13 +39,17 @@ void RigidBody::onSaveLoad(hd::JSON& data, bool isLoad) {
     hd::JSON &shapeFriction = data["friction"];
     hd::JSON &shapeRestitution = data["restitution"];
     hd::JSON &shapeSensor = data["isSensor"];
+    hd::JSON &shapes = data["shapes"];
+    hd::JSON &categoryBits = data["categoryBits"];
+    hd::JSON &maskBits = data["maskBits"];
+    hd::JSON &contactEventMask = data["contactEventMask"];
+    hd::JSON &preSolveEventsEnabled = data["isPreSolveEventsEnabled"];
 
     hd::JSON &components = data["components"];
     hd::JSON &children = data["children"];
 
     if (isLoad) {
-        mSetPosition(position.get<glm::vec2>());
-        mSetAngle(angle.get<float>());
+        mSetTransform(position.get<glm::vec2>(), angle.get<float>());
         setLinearVelocity(linearVelocity.get<glm::vec2>());
         setAngularVelocity(angularVelocity.get<float>());
         setLinearDamping(linearDamping.get<float>());
@@ -61,6 +67,41 @@ void RigidBody::onSaveLoad(hd::JSON& data, bool isLoad) {
         setShapeFriction(shapeFriction.get<float>());
         setShapeRestitution(shapeRestitution.get<float>());
         setShapeSensor(shapeSensor.get<bool>());
+        // Scenes saved before filtering and contact events existed keep the defaults
+        if (!categoryBits.is_null()) {
+            setCategoryBits(categoryBits.get<uint16_t>());
+        }
+        if (!maskBits.is_null()) {
+            setMaskBits(maskBits.get<uint16_t>());
+        }
+        if (!contactEventMask.is_null()) {
+            setContactEventMask(contactEventMask.get<uint16_t>());
+        }
+        if (!preSolveEventsEnabled.is_null()) {
+            setPreSolveEventsEnabled(preSolveEventsEnabled.get<bool>());
+        }
+
+        for (auto &it : shapes) {
+            ColliderShape shape;
+            shape.type = it["type"].get<ColliderShapeType>();
+            shape.offset = it["offset"].get<glm::vec2>();
+            shape.angle = it["angle"].get<float>();
+            shape.halfSize = it["halfSize"].get<glm::vec2>();
+            shape.radius = it["radius"].get<float>();
+            for (auto &point : it["points"]) {
+                shape.points.push_back(point.get<glm::vec2>());
+            }
+            shape.isLoop = it["isLoop"].get<bool>();
+            shape.density = it["density"].get<float>();
+            shape.friction = it["friction"].get<float>();
+            shape.restitution = it["restitution"].get<float>();
+            shape.isSensor = it["isSensor"].get<bool>();
+            addShape(shape);
+        }
+        mSavePreviousTransform();
+        mIsOwnerSynced = false;
+        mHasOwnerTransform = false;
+        mTrackMovement();
     }
     else {
         position = mGetPosition();
@@ -82,15 +123,41 @@ void RigidBody::onSaveLoad(hd::JSON& data, bool isLoad) {
         shapeFriction = getShapeFriction();
         shapeRestitution = getShapeRestitution();
         shapeSensor = isShapeSensor();
+        categoryBits = getCategoryBits();
+        maskBits = getMaskBits();
+        contactEventMask = getContactEventMask();
+        preSolveEventsEnabled = isPreSolveEventsEnabled();
+
+        shapes = hd::JSON::array();
+        for (const auto &shape : mShapes) {
+            hd::JSON it;
+            it["type"] = shape.type;
+            it["offset"] = shape.offset;
+            it["angle"] = shape.angle;
+            it["halfSize"] = shape.halfSize;
+            it["radius"] = shape.radius;
+            hd::JSON &points = it["points"];
+            points = hd::JSON::array();
+            for (const auto &point : shape.points) {
+                points.push_back(point);
+            }
+            it["isLoop"] = shape.isLoop;
+            it["density"] = shape.density;
+            it["friction"] = shape.friction;
+            it["restitution"] = shape.restitution;
+            it["isSensor"] = shape.isSensor;
+            shapes.push_back(it);
+        }
     }
 }
 
 void RigidBody::onCreate() {
-    mWorld = getScene().findComponent<PhysicsWorld>();
+    mWorld = PhysicsWorld::findNearest(getOwner());
     if (!mWorld) {
-        HD_LOG_FATAL("Failed to find 'PhysicsWorld' component at Scene");
+        HD_LOG_FATAL("Failed to find 'PhysicsWorld' component at '{}' or its ancestors", getOwner()->getName());
     }
     mBody = mWorld->getWorld().CreateBody(&mBodyDef);
+    mBody->SetUserData(this);
     mWorld->mAddRigidBody(this);
     onTransformUpdate();
 }
@@ -100,17 +167,53 @@ void RigidBody::onTransformUpdate() {
         return;
     }
 
-    mSetPosition(getOwner()->getWorldPosition());
-    mSetBoxShapeSize(getOwner()->getSize());
-    mSetAngle(getOwner()->getWorldAngle());
+    if (mShapes.empty()) {
+        mSetBoxShapeSize(getOwner()->getSize());
+    }
+
+    // The owner holds the interpolated transform, which lags behind the body, so it's pushed to Box2D only
+    // when the owner was moved. If only an ancestor moved it, the body follows with the same offset
+    const glm::vec2 &position = getOwner()->getWorldPosition();
+    float angle = getOwner()->getWorldAngle();
+    if (mHasOwnerTransform && position == mOwnerPosition && angle == mOwnerAngle) {
+        return;
+    }
+    if (mHasOwnerTransform && getOwner()->getPosition() == mOwnerLocalPosition && getOwner()->getAngle() == mOwnerLocalAngle) {
+        float deltaAngle = angle - mOwnerAngle;
+        float c = std::cos(deltaAngle);
+        float s = std::sin(deltaAngle);
+        auto move = [&](const glm::vec2 &p) {
+            glm::vec2 offset = p - mOwnerPosition;
+            return position + glm::vec2(c*offset.x - s*offset.y, s*offset.x + c*offset.y);
+        };
+        glm::vec2 prevPosition = move(mPrevPosition);
+        float prevAngle = mPrevAngle + deltaAngle;
+        mSetTransform(move(mGetPosition()), mGetAngle() + deltaAngle);
+        mPrevPosition = prevPosition;
+        mPrevAngle = prevAngle;
+        mAppliedPosition = position;
+        mAppliedAngle = angle;
+        mIsOwnerSynced = false;
+    }
+    else {
+        mSetTransform(position, angle);
+        mSavePreviousTransform(); // teleported, nothing to interpolate from
+        mAppliedPosition = mPrevPosition;
+        mAppliedAngle = mPrevAngle;
+        mIsOwnerSynced = true;
+    }
+    mSaveOwnerTransform();
+    mTrackMovement();
 }
 
 void RigidBody::setLinearVelocity(const glm::vec2 &vel) {
     mBody->SetLinearVelocity(toBox2D(vel));
+    mTrackMovement();
 }
 
 void RigidBody::setAngularVelocity(float vel) {
     mBody->SetAngularVelocity(vel);
+    mTrackMovement();
 }
 
 void RigidBody::setLinearDamping(float damping) {
@@ -127,6 +230,7 @@ void RigidBody::setSleepAllowed(bool allowed) {
 
 void RigidBody::setAwake(bool awake) {
     mBody->SetAwake(awake);
+    mTrackMovement();
 }
 
 void RigidBody::setFixedRotation(bool fixedRotation) {
@@ -139,37 +243,116 @@ void RigidBody::setBullet(bool bullet) {
 
 void RigidBody::setType(BodyType type) {
     mBody->SetType(static_cast<b2BodyType>(type));
+    mTrackMovement();
 }
 
 void RigidBody::setActive(bool active) {
     mBody->SetActive(active);
+    mTrackMovement();
 }
 
 void RigidBody::setGravityScale(float scale) {
     mBody->SetGravityScale(scale);
 }
 
+size_t RigidBody::addShape(const ColliderShape &shape) {
+    b2Fixture *fixture = mCreateFixture(shape);
+    if (!fixture) {
+        return INVALID_SHAPE;
+    }
+    if (mShapes.empty() && mFixture) {
+        mBody->DestroyFixture(mFixture);
+        mFixture = nullptr;
+    }
+
+    mShapes.push_back(shape);
+    mShapeFixtures.push_back(fixture);
+    return mShapes.size() - 1;
+}
+
+void RigidBody::removeShape(size_t index) {
+    if (index >= mShapes.size()) {
+        HD_LOG_ERROR("Invalid shape index {}, body has {} shapes", index, mShapes.size());
+        return;
+    }
+
+    mBody->DestroyFixture(mShapeFixtures[index]);
+    mShapes.erase(mShapes.begin() + index);
+    mShapeFixtures.erase(mShapeFixtures.begin() + index);
+    if (mShapes.empty()) {
+        mSetBoxShapeSize(getOwner()->getSize());
+    }
+}
+
+void RigidBody::clearShapes() {
+    for (auto &fixture : mShapeFixtures) {
+        mBody->DestroyFixture(fixture);
+    }
+    mShapes.clear();
+    mShapeFixtures.clear();
+    mSetBoxShapeSize(getOwner()->getSize());
+}
+
+void RigidBody::setCategoryBits(uint16_t bits) {
+    mCategoryBits = bits;
+    for (b2Fixture *fixture = mBody->GetFixtureList(); fixture; fixture = fixture->GetNext()) {
+        b2Filter filter = fixture->GetFilterData();
+        filter.categoryBits = bits;
+        fixture->SetFilterData(filter);
+    }
+}
+
+void RigidBody::setMaskBits(uint16_t bits) {
+    mMaskBits = bits;
+    for (b2Fixture *fixture = mBody->GetFixtureList(); fixture; fixture = fixture->GetNext()) {
+        b2Filter filter = fixture->GetFilterData();
+        filter.maskBits = bits;
+        fixture->SetFilterData(filter);
+    }
+}
+
+void RigidBody::setContactEventMask(uint16_t bits) {
+    mContactEventMask = bits;
+}
+
+void RigidBody::setPreSolveEventsEnabled(bool enabled) {
+    mIsPreSolveEventsEnabled = enabled;
+}
+
 void RigidBody::setShapeDensity(float density) {
-    if (mFixture) {
-        mFixture->SetDensity(density);
+    for (b2Fixture *fixture = mBody->GetFixtureList(); fixture; fixture = fixture->GetNext()) {
+        fixture->SetDensity(density);
     }
+    for (auto &shape : mShapes) {
+        shape.density = density;
+    }
+    mBody->ResetMassData();
 }
 
 void RigidBody::setShapeFriction(float friction) {
-    if (mFixture) {
-        mFixture->SetFriction(friction);
+    for (b2Fixture *fixture = mBody->GetFixtureList(); fixture; fixture = fixture->GetNext()) {
+        fixture->SetFriction(friction);
+    }
+    for (auto &shape : mShapes) {
+        shape.friction = friction;
     }
 }
 
 void RigidBody::setShapeRestitution(float restitution) {
-    if (mFixture) {
-        mFixture->SetRestitution(restitution);
+    for (b2Fixture *fixture = mBody->GetFixtureList(); fixture; fixture = fixture->GetNext()) {
+        fixture->SetRestitution(restitution);
+    }
+    for (auto &shape : mShapes) {
+        shape.restitution = restitution;
     }
 }
 
 void RigidBody::setShapeSensor(bool sensor) {
-    if (mFixture) {
-        mFixture->SetSensor(sensor);
+    for (b2Fixture *fixture = mBody->GetFixtureList(); fixture; fixture = fixture->GetNext()) {
+        fixture->SetSensor(sensor);
+    }
+    for (auto &shape : mShapes) {
+        shape.isSensor = sensor;
     }
 }
 
@@ -217,9 +400,30 @@ float RigidBody::getGravityScale() const {
     return mBody->GetGravityScale();
 }
 
+uint16_t RigidBody::getCategoryBits() const {
+    return mCategoryBits;
+}
+
+uint16_t RigidBody::getMaskBits() const {
+    return mMaskBits;
+}
+
+uint16_t RigidBody::getContactEventMask() const {
+    return mContactEventMask;
+}
+
+bool RigidBody::isPreSolveEventsEnabled() const {
+    return mIsPreSolveEventsEnabled;
+}
+
+const std::vector<ColliderShape> &RigidBody::getShapes() const {
+    return mShapes;
+}
+
 float RigidBody::getShapeDensity() const {
-    if (mFixture) {
-        return mFixture->GetDensity();
+    b2Fixture *fixture = mGetFirstFixture();
+    if (fixture) {
+        return fixture->GetDensity();
     }
     else {
         return 0.0f;
@@ -227,8 +431,9 @@ float RigidBody::getShapeDensity() const {
 }
 
 float RigidBody::getShapeFriction() const {
-    if (mFixture) {
-        return mFixture->GetFriction();
+    b2Fixture *fixture = mGetFirstFixture();
+    if (fixture) {
+        return fixture->GetFriction();
     }
     else {
         return 0.0f;
@@ -236,8 +441,9 @@ float RigidBody::getShapeFriction() const {
 }
 
 float RigidBody::getShapeRestitution() const {
-    if (mFixture) {
-        return mFixture->GetRestitution();
+    b2Fixture *fixture = mGetFirstFixture();
+    if (fixture) {
+        return fixture->GetRestitution();
     }
     else {
         return 0.0f;
@@ -245,39 +451,118 @@ float RigidBody::getShapeRestitution() const {
 }
 
 bool RigidBody::isShapeSensor() const {
-    if (mFixture) {
-        return mFixture->IsSensor();
+    b2Fixture *fixture = mGetFirstFixture();
+    if (fixture) {
+        return fixture->IsSensor();
     }
     else {
         return false;
     }
 }
 
-void RigidBody::mSetPosition(const glm::vec2 &pos) {
-    mBody->SetTransform(toBox2D(pos), mBody->GetAngle());
+void RigidBody::mSetTransform(const glm::vec2 &pos, float angle) {
+    // SetTransform moves every fixture in the broadphase, so it's skipped when nothing changed
+    if (mGetPosition() != pos || mGetAngle() != angle) {
+        mBody->SetTransform(toBox2D(pos), angle);
+    }
 }
 
 void RigidBody::mSetBoxShapeSize(const glm::vec2& size) {
-    if (mFixture) {
-        mBody->DestroyFixture(mFixture);
+    if (mFixture && size == mBoxShapeSize) {
+        return;
     }
 
-    mBoxShapeSize = size;
     b2PolygonShape shape;
     shape.SetAsBox(size.x, size.y);
     b2FixtureDef fd;
+    fd.filter.categoryBits = mCategoryBits;
+    fd.filter.maskBits = mMaskBits;
     fd.shape = &shape;
-    mFixture = mBody->CreateFixture(&fd);
-}
+    if (mFixture) {
+        // Material of the old fixture is kept
+        fd.density = mFixture->GetDensity();
+        fd.friction = mFixture->GetFriction();
+        fd.restitution = mFixture->GetRestitution();
+        fd.isSensor = mFixture->IsSensor();
+        mBody->DestroyFixture(mFixture);
+    }
 
-void RigidBody::mSetAngle(float angle) {
-    mBody->SetTransform(mBody->GetPosition(), angle);
+    mBoxShapeSize = size;
+    mFixture = mBody->CreateFixture(&fd);
 }
 
 glm::vec2 RigidBody::mGetPosition() const {
     return fromBox2D(mBody->GetPosition());
 }
 
+b2Fixture *RigidBody::mCreateFixture(const ColliderShape &shape) {
+    b2FixtureDef fd;
+    fd.filter.categoryBits = mCategoryBits;
+    fd.filter.maskBits = mMaskBits;
+    fd.density = shape.density;
+    fd.friction = shape.friction;
+    fd.restitution = shape.restitution;
+    fd.isSensor = shape.isSensor;
+
+    std::vector<b2Vec2> vertices;
+    for (const auto &point : shape.points) {
+        vertices.push_back(toBox2D(point + (shape.type == ColliderShapeType::Polygon ? shape.offset : glm::vec2(0, 0))));
+    }
+
+    switch (shape.type) {
+        case ColliderShapeType::Box: {
+            b2PolygonShape box;
+            box.SetAsBox(shape.halfSize.x, shape.halfSize.y, toBox2D(shape.offset), shape.angle);
+            fd.shape = &box;
+            return mBody->CreateFixture(&fd);
+        }
+        case ColliderShapeType::Circle: {
+            b2CircleShape circle;
+            circle.m_p = toBox2D(shape.offset);
+            circle.m_radius = shape.radius;
+            fd.shape = &circle;
+            return mBody->CreateFixture(&fd);
+        }
+        case ColliderShapeType::Polygon: {
+            if (vertices.size() < 3 || vertices.size() > b2_maxPolygonVertices) {
+                HD_LOG_ERROR("Polygon shape must have from 3 to {} points, got {}", b2_maxPolygonVertices, vertices.size());
+                return nullptr;
+            }
+            b2PolygonShape polygon;
+            polygon.Set(vertices.data(), static_cast<int32>(vertices.size()));
+            fd.shape = &polygon;
+            return mBody->CreateFixture(&fd);
+        }
+        case ColliderShapeType::Chain: {
+            if (vertices.size() < (shape.isLoop ? 3u : 2u)) {
+                HD_LOG_ERROR("Chain shape has too few points: {}", vertices.size());
+                return nullptr;
+            }
+            b2ChainShape chain;
+            if (shape.isLoop) {
+                chain.CreateLoop(vertices.data(), static_cast<int32>(vertices.size()));
+            }
+            else {
+                chain.CreateChain(vertices.data(), static_cast<int32>(vertices.size()));
+            }
+            fd.shape = &chain;
+            return mBody->CreateFixture(&fd);
+        }
+    }
+
+    HD_LOG_FATAL("Unknown collider shape type {}", static_cast<int>(shape.type));
+    return nullptr;
+}
+
+b2Fixture *RigidBody::mGetFirstFixture() const {
+    if (mFixture) {
+        return mFixture;
+    }
+    else {
+        return mShapeFixtures.empty() ? nullptr : mShapeFixtures.front();
+    }
+}
+
 const glm::vec2& RigidBody::mGetBoxShapeSize() const {
     return mBoxShapeSize;
 }
@@ -286,10 +571,44 @@ float RigidBody::mGetAngle() const {
     return mBody->GetAngle();
 }
 
-void RigidBody::mApplyTransformToOwner() {
-    getOwner()->setWorldPosition(mGetPosition());
-    getOwner()->setSize(mGetBoxShapeSize());
-    getOwner()->setWorldAngle(mGetAngle());
+void RigidBody::mSavePreviousTransform() {
+    mPrevPosition = mGetPosition();
+    mPrevAngle = mGetAngle();
+}
+
+void RigidBody::mApplyTransformToOwner(float alpha) {
+    // Bodies that can't move are skipped once their owner has the final transform
+    if ((mBody->GetType() == b2_staticBody || !mBody->IsAwake()) && mIsOwnerSynced) {
+        return;
+    }
+
+    glm::vec2 position = mGetPosition();
+    float angle = mGetAngle();
+    glm::vec2 interpolatedPosition = glm::mix(mPrevPosition, position, alpha);
+    float interpolatedAngle = glm::mix(mPrevAngle, angle, alpha);
+    if (interpolatedPosition != mAppliedPosition || interpolatedAngle != mAppliedAngle || !mIsOwnerSynced) {
+        if (mShapes.empty() && getOwner()->getSize() != mBoxShapeSize) {
+            getOwner()->setSize(mBoxShapeSize);
+        }
+        getOwner()->setWorldTransform(interpolatedPosition, interpolatedAngle);
+        mAppliedPosition = interpolatedPosition;
+        mAppliedAngle = interpolatedAngle;
+        mSaveOwnerTransform();
+    }
+    mIsOwnerSynced = interpolatedPosition == position && interpolatedAngle == angle;
+}
+
+void RigidBody::mSaveOwnerTransform() {
+    mOwnerPosition = getOwner()->getWorldPosition();
+    mOwnerAngle = getOwner()->getWorldAngle();
+    mOwnerLocalPosition = getOwner()->getPosition();
+    mOwnerLocalAngle = getOwner()->getAngle();
+    mHasOwnerTransform = true;
+}
+
+void RigidBody::mTrackMovement() {
+    // Bodies are written back only while they are tracked as awake by the world
+    mWorld->mTrackAwakeBody(this);
 }
 
 }
@@ -1,11 +1,14 @@
 #pragma once
 #include "Component.hpp"
+#include "hd/Core/Delegate.hpp"
 #include "glm/glm.hpp"
 #include "Box2D/Box2D.h"
+#include <vector>
 
 namespace hg {
 
 class PhysicsWorld;
+class RigidBody;
 
 enum class BodyType {
     Static = b2_staticBody,
@@ -13,6 +16,45 @@ enum class BodyType {
     Dynamic = b2_dynamicBody
 };
 
+enum class ColliderShapeType {
+    Box,
+    Circle,
+    Polygon,
+    Chain
+};
+
+// Shapes are in body space and aren't scaled by the owner's size
+struct ColliderShape {
+    ColliderShapeType type = ColliderShapeType::Box;
+    glm::vec2 offset = glm::vec2(0, 0); // Box, Circle, Polygon
+    float angle = 0.0f; // Box
+    glm::vec2 halfSize = glm::vec2(0.5f, 0.5f); // Box
+    float radius = 0.5f; // Circle
+    std::vector<glm::vec2> points; // Polygon (3..b2_maxPolygonVertices, convex), Chain (2+)
+    bool isLoop = false; // Chain
+
+    float density = 0.0f;
+    float friction = 0.2f;
+    float restitution = 0.0f;
+    bool isSensor = false;
+};
+
+enum class ContactEventType {
+    Begin,
+    End,
+    PreSolve
+};
+
+// Recorded during the step and delivered after it, so PreSolve can't change the contact
+struct ContactEvent {
+    ContactEventType type;
+    RigidBody *otherBody; // nullptr for colliders without RigidBody, like Tilemap chunks
+    bool isSensor; // one of the fixtures is a sensor, no points and normal then
+    glm::vec2 normal; // points from this body to the other one
+    glm::vec2 point;
+    int32_t pointCount;
+};
+
 class RigidBody : public Component {
     HG_OBJECT(RigidBody, Component);
     friend class PhysicsWorld;
@@ -35,6 +77,21 @@ public:
     void setActive(bool active);
     void setGravityScale(float scale);
 
+    static const size_t INVALID_SHAPE = static_cast<size_t>(-1);
+
+    // Without added shapes the body has one box sized from the owner.
+    // Shapes with a wrong number of points are rejected and INVALID_SHAPE is returned
+    size_t addShape(const ColliderShape &shape);
+    void removeShape(size_t index);
+    void clearShapes();
+
+    // Collision filtering of all fixtures, they collide when each one's category is in the other's mask
+    void setCategoryBits(uint16_t bits);
+    void setMaskBits(uint16_t bits);
+    // Contact events are delivered only for other bodies whose category is in this mask
+    void setContactEventMask(uint16_t bits);
+    void setPreSolveEventsEnabled(bool enabled);
+
     void setShapeDensity(float density);
     void setShapeFriction(float friction);
     void setShapeRestitution(float restitution);
@@ -52,25 +109,60 @@ public:
     bool isActive() const;
     float getGravityScale() const;
 
+    uint16_t getCategoryBits() const;
+    uint16_t getMaskBits() const;
+    uint16_t getContactEventMask() const;
+    bool isPreSolveEventsEnabled() const;
+
+    const std::vector<ColliderShape> &getShapes() const;
     float getShapeDensity() const;
     float getShapeFriction() const;
     float getShapeRestitution() const;
     bool isShapeSensor() const;
 
+    hd::Delegate<const ContactEvent&> onContactBegin, onContactEnd, onContactPreSolve;
+
 private:
-    void mSetPosition(const glm::vec2 &pos);
+    void mSetTransform(const glm::vec2 &pos, float angle);
     void mSetBoxShapeSize(const glm::vec2 &size);
-    void mSetAngle(float angle);
+    b2Fixture *mCreateFixture(const ColliderShape &shape);
+    b2Fixture *mGetFirstFixture() const;
     glm::vec2 mGetPosition() const;
     const glm::vec2 &mGetBoxShapeSize() const;
     float mGetAngle() const;
-    void mApplyTransformToOwner();
+    void mSavePreviousTransform();
+    void mApplyTransformToOwner(float alpha);
+    void mSaveOwnerTransform();
+    void mTrackMovement();
 
     PhysicsWorld *mWorld;
+    size_t mDepthInWorld = 0;
+    size_t mIndexInWorld = 0;
+    uint32_t mIdInWorld = 0; // creation order, matches bodies with their snapshot states
+    size_t mIndexInAwakeList = 0;
+    bool mIsAwakeTracked = false;
+    uint32_t mPendingContactsCount = 0; // contact records naming this body which wait for dispatch
     b2BodyDef mBodyDef;
     b2Body *mBody = nullptr;
     b2Fixture *mFixture = nullptr;
     glm::vec2 mBoxShapeSize = glm::vec2(0, 0);
+    std::vector<ColliderShape> mShapes;
+    std::vector<b2Fixture*> mShapeFixtures;
+    uint16_t mCategoryBits = 0x0001;
+    uint16_t mMaskBits = 0xFFFF;
+    uint16_t mContactEventMask = 0xFFFF;
+    bool mIsPreSolveEventsEnabled = false;
+    glm::vec2 mPrevPosition = glm::vec2(0, 0);
+    float mPrevAngle = 0.0f;
+    glm::vec2 mAppliedPosition = glm::vec2(0, 0);
+    float mAppliedAngle = 0.0f;
+    bool mIsOwnerSynced = false;
+    // The owner's world and local transform after the last write-back, to tell which moves came from outside
+    glm::vec2 mOwnerPosition = glm::vec2(0, 0);
+    float mOwnerAngle = 0.0f;
+    glm::vec2 mOwnerLocalPosition = glm::vec2(0, 0);
+    float mOwnerLocalAngle = 0.0f;
+    bool mHasOwnerTransform = false;
 };
 
 }
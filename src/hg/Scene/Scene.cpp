@@ -1,35 +1,89 @@
 #include "Scene.hpp"
 #include "Camera.hpp"
+#include "PhysicsWorld.hpp"
 #include "../Core/Engine.hpp"
+#include "../Core/BinaryArchive.hpp"
 #include "../Renderer2D/RenderSystem2D.hpp"
+#include "../Core/Profiler.hpp"
+#include "../Core/MemoryTracker.hpp"
 #include "hd/IO/FileStream.hpp"
 
 namespace hg {
 
+Scene::~Scene() {
+    clear();
+}
+
 void Scene::onEvent(const WindowEvent &event) {
     mOnEvent(event);
 }
 
 void Scene::onFixedUpdate() {
+    HG_PROFILE_SCOPE("Scene::onFixedUpdate");
+    HG_MEMORY_TAG(MemoryTag::Scene);
     mOnFixedUpdate();
+    mFlushDestroyed();
 }
 
 void Scene::onUpdate(float dt) {
-    for (auto &component : mComponentsForFirstUpdate) {
-        component->onFirstUpdate();
+    HG_PROFILE_SCOPE("Scene::onUpdate");
+    HG_MEMORY_TAG(MemoryTag::Scene);
+    // chunk instantiated here gets onFirstUpdate below, only after the whole chunk is built
+    mLoader.update(mLoadingTimeBudget);
+
+    // The queue is walked in place, so components destroyed by onFirstUpdate are nulled in it before they are reached.
+    // onFirstUpdate may create new components, they are handled in the next frame
+    mFirstUpdateEnd = mComponentsForFirstUpdate.size();
+    for (size_t i = 0; i < mFirstUpdateEnd; i++) {
+        Component *component = mComponentsForFirstUpdate[i];
+        if (component) {
+            component->mIsWaitingFirstUpdate = false;
+            component->onFirstUpdate();
+        }
     }
-    mComponentsForFirstUpdate.clear();
+    size_t count = 0;
+    for (size_t i = mFirstUpdateEnd; i < mComponentsForFirstUpdate.size(); i++) {
+        Component *component = mComponentsForFirstUpdate[i];
+        if (component) {
+            component->mFirstUpdateIndex = count;
+            mComponentsForFirstUpdate[count++] = component;
+        }
+    }
+    mComponentsForFirstUpdate.resize(count);
+    mFirstUpdateEnd = 0;
 
-    if (mCamera) {
-        getRenderSystem2D().setCamera(mCamera->getOwner()->getWorldPosition(), mCamera->getOwner()->getWorldAngle(), mCamera->getDistance());
+    if (Camera *camera = mCamera.get()) {
+        getRenderSystem2D().setCamera(camera->getOwner()->getWorldPosition(), camera->getOwner()->getWorldAngle(), camera->getDistance());
     }
     else {
         getRenderSystem2D().setCamera(glm::vec2(0, 0), 0.0f, 1.0f);
     }
+    PhysicsWorld::stepWorlds(dt);
     mOnUpdate(dt);
+    mFlushDestroyed();
 }
 
 void Scene::clear() {
+    mLoader.cancel();
+    for (auto &component : mPendingDestroyComponents) {
+        if (component) {
+            component->mIsPendingDestroy = false;
+        }
+    }
+    mPendingDestroyComponents.clear();
+    for (auto &go : mPendingDestroy) {
+        if (go) {
+            go->mIsPendingDestroy = false;
+        }
+    }
+    mPendingDestroy.clear();
+    for (auto &component : mComponentsForFirstUpdate) {
+        if (component) {
+            component->mIsWaitingFirstUpdate = false;
+        }
+    }
+    mComponentsForFirstUpdate.clear();
+    mFirstUpdateEnd = 0;
     destroyAllChildren();
     destroyAllComponents();
 }
@@ -43,21 +97,56 @@ void Scene::save(const std::string &path) {
     file.writeLine(text);
 }
 
-void Scene::load(const std::string &path) {
-    clear();
+void Scene::saveBinary(const std::string &path) {
+    hd::JSON data;
+    mOnSaveLoad(data, false);
+    std::vector<uint8_t> buffer = BinaryArchive::write(data);
+
+    hd::FileStream file = hd::FileStream(mGetFullPath(path), hd::FileMode::Write);
+    file.write(buffer.data(), buffer.size());
+}
 
+bool Scene::load(const std::string &path) {
     hd::FileStream file = hd::FileStream(mGetFullPath(path), hd::FileMode::Read);
-    std::string text = file.readAllText();
+    std::vector<uint8_t> buffer = file.readAllBuffer();
 
-    hd::JSON data = hd::JSON::parse(text);
+    // The current scene is kept if the level can't be read
+    hd::JSON data;
+    if (!BinaryArchive::parse(buffer, data)) {
+        HD_LOG_ERROR("Failed to load scene '{}'", path);
+        return false;
+    }
+    clear();
     mOnSaveLoad(data, true);
+    return true;
+}
+
+void Scene::loadAsync(const std::string &path) {
+    clear();
+    mLoader.start(mGetFullPath(path), this, true);
+}
+
+void Scene::appendAsync(const std::string &path) {
+    mLoader.start(mGetFullPath(path), this, false);
+}
+
+void Scene::setLoadingTimeBudget(float ms) {
+    mLoadingTimeBudget = glm::max(ms, 0.0f);
+}
+
+bool Scene::isLoading() const {
+    return mLoader.isLoading();
+}
+
+float Scene::getLoadingProgress() const {
+    return mLoader.getProgress();
 }
 
 void Scene::setCameraObject(GameObject *go) {
     if (go) {
         Camera *camera = go->findComponent<Camera>();
         if (camera) {
-            mCamera = camera;
+            mCamera = PoolHandle<Camera>(camera);
         }
         else {
             HD_LOG_WARNING("Failed to set GameObject without Camera component as scene Camera");
@@ -68,19 +157,120 @@ void Scene::setCameraObject(GameObject *go) {
     }
 }
 
+PrefabPtr Scene::loadPrefab(const std::string &path) {
+    HG_MEMORY_TAG(MemoryTag::Resources);
+    if (!path.empty()) {
+        hd::StringHash pathHash = hd::StringHash(path);
+        auto it = mPrefabs.find(pathHash);
+        if (it == mPrefabs.end()) {
+            PrefabPtr prefab = Prefab::createFromFile(path);
+            mPrefabs.insert(std::make_pair(pathHash, prefab));
+            return prefab;
+        }
+        else {
+            return it->second;
+        }
+    }
+    else {
+        HD_LOG_FATAL("Failed to load prefab. Path is empty");
+        return PrefabPtr();
+    }
+}
+
 std::string Scene::mGetFullPath(const std::string &path) {
     return "./data/levels/" + path;
 }
 
 void Scene::mOnCreateComponent(Component *component) {
+    component->mIsWaitingFirstUpdate = true;
+    component->mFirstUpdateIndex = mComponentsForFirstUpdate.size();
     mComponentsForFirstUpdate.push_back(component);
 }
 
 void Scene::mOnDestroyComponent(Component *component) {
-    if (mCamera == component) {
-        mCamera = nullptr;
-        HD_LOG_INFO("Active camera component was destroyed");
+    if (component->mIsPendingDestroy) {
+        mPendingDestroyComponents[component->mPendingDestroyIndex] = nullptr;
+        component->mIsPendingDestroy = false;
+    }
+    if (component->mIsWaitingFirstUpdate) {
+        mComponentsForFirstUpdate[component->mFirstUpdateIndex] = nullptr;
+        component->mIsWaitingFirstUpdate = false;
+    }
+}
+
+void Scene::mQueueDestroy(GameObject *go) {
+    if (!go->mIsPendingDestroy) {
+        go->mIsPendingDestroy = true;
+        go->mPendingDestroyIndex = mPendingDestroy.size();
+        mPendingDestroy.push_back(go);
+    }
+}
+
+void Scene::mQueueDestroy(Component *component) {
+    if (!component->mIsPendingDestroy) {
+        component->mIsPendingDestroy = true;
+        component->mPendingDestroyIndex = mPendingDestroyComponents.size();
+        mPendingDestroyComponents.push_back(component);
+    }
+}
+
+void Scene::mCancelDestroy(GameObject *go) {
+    // Called from the destructor of a queued object which was destroyed some other way
+    mPendingDestroy[go->mPendingDestroyIndex] = nullptr;
+    go->mIsPendingDestroy = false;
+}
+
+void Scene::mFlushDestroyed() {
+    HG_PROFILE_SCOPE("Scene::flushDestroyed");
+    // Components go first, the ones owned by destroyed objects would be removed from the queue anyway
+    for (size_t i = 0; i < mPendingDestroyComponents.size(); i++) {
+        Component *component = mPendingDestroyComponents[i];
+        if (component) {
+            component->getOwner()->mRemoveDestroyedComponent(component);
+        }
+    }
+    mPendingDestroyComponents.clear();
+
+    if (mPendingDestroy.empty()) {
+        return;
+    }
+
+    // Objects queued together with one of their ancestors are destroyed by it
+    std::vector<GameObject*> parents;
+    const size_t pendingCount = mPendingDestroy.size();
+    for (size_t i = 0; i < pendingCount; i++) {
+        GameObject *go = mPendingDestroy[i];
+        if (!go) {
+            continue;
+        }
+        bool isAncestorPending = false;
+        for (GameObject *parent = go->getParent(); parent && !isAncestorPending; parent = parent->getParent()) {
+            isAncestorPending = parent->mIsPendingDestroy;
+        }
+        if (!isAncestorPending && !go->mParent->mHasPendingDestroyChildren) {
+            go->mParent->mHasPendingDestroyChildren = true;
+            parents.push_back(go->mParent);
+        }
+    }
+
+    std::vector<GameObject*> destroyed;
+    for (auto &parent : parents) {
+        parent->mRemoveDestroyedChildren(destroyed);
+    }
+    for (auto &go : destroyed) {
+        HD_DELETE(go);
+    }
+
+    // Destructors may have queued new objects, they wait for the next flush
+    size_t count = 0;
+    for (size_t i = pendingCount; i < mPendingDestroy.size(); i++) {
+        GameObject *go = mPendingDestroy[i];
+        if (go) {
+            go->mPendingDestroyIndex = count;
+            mPendingDestroy[count++] = go;
+        }
     }
+    mPendingDestroy.resize(count);
 }
 
 Scene &getScene() {
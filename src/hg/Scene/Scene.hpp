@@ -1,5 +1,7 @@
 #pragma once
 #include "GameObject.hpp"
+#include "Prefab.hpp"
+#include "SceneLoader.hpp"
 
 namespace hg {
 
@@ -7,25 +9,47 @@ class Camera;
 
 class Scene : public GameObject {
     friend class GameObject;
+    friend class Component;
 public:
+    ~Scene();
+
     void onEvent(const WindowEvent &event);
     void onFixedUpdate();
     void onUpdate(float dt);
 
     void clear();
     void save(const std::string &path);
-    void load(const std::string &path);
+    void saveBinary(const std::string &path);
+    bool load(const std::string &path);
+    void loadAsync(const std::string &path);
+    void appendAsync(const std::string &path);
+
+    void setLoadingTimeBudget(float ms);
+    bool isLoading() const;
+    float getLoadingProgress() const;
 
     void setCameraObject(GameObject *go);
 
+    PrefabPtr loadPrefab(const std::string &path);
+
 private:
     static std::string mGetFullPath(const std::string &path);
 
     void mOnCreateComponent(Component *component);
     void mOnDestroyComponent(Component *component);
+    void mQueueDestroy(GameObject *go);
+    void mQueueDestroy(Component *component);
+    void mCancelDestroy(GameObject *go);
+    void mFlushDestroyed();
 
     std::vector<Component*> mComponentsForFirstUpdate;
-    Camera *mCamera = nullptr;
+    size_t mFirstUpdateEnd = 0; // components queued before the current onFirstUpdate pass
+    std::vector<GameObject*> mPendingDestroy;
+    std::vector<Component*> mPendingDestroyComponents;
+    PoolHandle<Camera> mCamera; // becomes null once the component is deleted
+    std::unordered_map<hd::StringHash, PrefabPtr> mPrefabs;
+    SceneLoader mLoader;
+    float mLoadingTimeBudget = 4.0f;
 };
 
 Scene &getScene();
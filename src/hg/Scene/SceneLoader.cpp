@@ -0,0 +1,102 @@
+#include "SceneLoader.hpp"
+#include "../Core/BinaryArchive.hpp"
+#include "hd/IO/FileStream.hpp"
+#include <chrono>
+
+namespace hg {
+
+void SceneLoader::start(const std::string &fullPath, GameObject *target, bool loadRoot) {
+    cancel();
+
+    mTarget = target;
+    mIsLoadRoot = loadRoot;
+    mIsLoading = true;
+    mParseTask = std::async(std::launch::async, [fullPath]() {
+        hd::FileStream file = hd::FileStream(fullPath, hd::FileMode::Read);
+        std::vector<uint8_t> buffer = file.readAllBuffer();
+
+        hd::JSON data;
+        if (!BinaryArchive::parse(buffer, data)) {
+            return std::unique_ptr<ParsedLevel>(); // the reason is logged by the archive
+        }
+        std::unique_ptr<ParsedLevel> level = std::make_unique<ParsedLevel>();
+        Prefab::parseNode(level->root, data);
+        level->nodesCount = Prefab::getNodesCount(level->root);
+        return level;
+    });
+}
+
+void SceneLoader::cancel() {
+    if (mParseTask.valid()) {
+        mParseTask.wait();
+        mParseTask = std::future<std::unique_ptr<ParsedLevel>>();
+    }
+    mLevel.reset();
+    mTarget = nullptr;
+    mIsLoading = false;
+    mNextChild = 0;
+    mLoadedNodesCount = 0;
+}
+
+bool SceneLoader::update(float timeBudget) {
+    if (!mIsLoading) {
+        return false;
+    }
+
+    if (!mLevel) {
+        if (mParseTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+        // Missing files and levels without required keys throw on the worker
+        try {
+            mLevel = mParseTask.get();
+        }
+        catch (const std::exception &e) {
+            HD_LOG_ERROR("Failed to load level. {}", e.what());
+        }
+        if (!mLevel) {
+            cancel();
+            return false;
+        }
+
+        mLoadedNodesCount = 1;
+        if (mIsLoadRoot) {
+            Prefab::applyNode(mLevel->root, mTarget);
+        }
+    }
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(timeBudget));
+    const std::vector<PrefabNode> &children = mLevel->root.children;
+    do {
+        if (mNextChild >= children.size()) {
+            break;
+        }
+        const PrefabNode &node = children[mNextChild++];
+        Prefab::instantiateNode(node, mTarget->createChild());
+        mLoadedNodesCount += Prefab::getNodesCount(node);
+    } while (Clock::now() < deadline);
+
+    if (mNextChild >= children.size()) {
+        mLevel.reset();
+        mTarget = nullptr;
+        mIsLoading = false;
+    }
+    return true;
+}
+
+bool SceneLoader::isLoading() const {
+    return mIsLoading;
+}
+
+float SceneLoader::getProgress() const {
+    if (!mIsLoading) {
+        return 1.0f;
+    }
+    if (!mLevel) {
+        return 0.0f;
+    }
+    return static_cast<float>(mLoadedNodesCount) / static_cast<float>(mLevel->nodesCount);
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "Prefab.hpp"
+#include <future>
+#include <memory>
+
+namespace hg {
+
+// Parses a level on a worker thread and instantiates it into the target object in time-sliced chunks.
+// Each top-level child of the level is one chunk and is always built completely within a frame
+class SceneLoader {
+public:
+    void start(const std::string &fullPath, GameObject *target, bool loadRoot);
+    void cancel();
+    bool update(float timeBudget);
+
+    bool isLoading() const;
+    float getProgress() const;
+
+private:
+    struct ParsedLevel {
+        PrefabNode root;
+        size_t nodesCount = 0;
+    };
+
+    std::future<std::unique_ptr<ParsedLevel>> mParseTask;
+    std::unique_ptr<ParsedLevel> mLevel;
+    GameObject *mTarget = nullptr;
+    bool mIsLoadRoot = false;
+    bool mIsLoading = false;
+    size_t mNextChild = 0;
+    size_t mLoadedNodesCount = 0;
+};
+
+}
@@ -0,0 +1,276 @@
+#include "SpatialIndex.hpp"
+#include "SpatialProxy.hpp"
+#include "GameObject.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace hg {
+
+static bool intersectRayAABB(const glm::vec2 &origin, const glm::vec2 &invDir, const glm::vec2 &min, const glm::vec2 &max, float maxDistance, float &distance) {
+    float tMin = 0.0f;
+    float tMax = maxDistance;
+    for (int i = 0; i < 2; i++) {
+        float t1 = (min[i] - origin[i])*invDir[i];
+        float t2 = (max[i] - origin[i])*invDir[i];
+        if (std::isnan(t1) || std::isnan(t2)) { // ray is parallel to the slab and starts on its border
+            continue;
+        }
+        tMin = std::max(tMin, std::min(t1, t2));
+        tMax = std::min(tMax, std::max(t1, t2));
+    }
+    distance = tMin;
+    return tMin <= tMax;
+}
+
+void SpatialIndex::onSaveLoad(hd::JSON &data, bool isLoad) {
+    hd::JSON &cellSize = data["cellSize"];
+    if (isLoad) {
+        setCellSize(cellSize.get<float>());
+    }
+    else {
+        cellSize = getCellSize();
+    }
+}
+
+void SpatialIndex::queryRegion(const glm::vec2 &min, const glm::vec2 &max, std::vector<SpatialProxy*> &result) {
+    mQueryStamp++;
+    glm::ivec2 cellMin = mGetCell(min);
+    glm::ivec2 cellMax = mGetCell(max);
+    for (int y = cellMin.y; y <= cellMax.y; y++) {
+        for (int x = cellMin.x; x <= cellMax.x; x++) {
+            auto cell = mCells.find(mGetCellKey(x, y));
+            if (cell == mCells.end()) {
+                continue;
+            }
+            for (auto &proxy : cell->second) {
+                if (proxy->mQueryStamp != mQueryStamp) {
+                    proxy->mQueryStamp = mQueryStamp;
+                    if (proxy->mMin.x <= max.x && proxy->mMax.x >= min.x && proxy->mMin.y <= max.y && proxy->mMax.y >= min.y) {
+                        result.push_back(proxy);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void SpatialIndex::queryRadius(const glm::vec2 &center, float radius, std::vector<SpatialProxy*> &result) {
+    size_t first = result.size();
+    queryRegion(center - glm::vec2(radius, radius), center + glm::vec2(radius, radius), result);
+
+    const float radiusSq = radius*radius;
+    auto end = std::remove_if(result.begin() + first, result.end(), [&](const SpatialProxy *proxy) {
+        glm::vec2 closest = glm::clamp(center, proxy->mMin, proxy->mMax);
+        glm::vec2 delta = closest - center;
+        return delta.x*delta.x + delta.y*delta.y > radiusSq;
+    });
+    result.erase(end, result.end());
+}
+
+void SpatialIndex::queryRay(const glm::vec2 &origin, const glm::vec2 &dir, float maxDistance, std::vector<SpatialRayHit> &result) {
+    float dirLength = std::sqrt(dir.x*dir.x + dir.y*dir.y);
+    if (dirLength == 0.0f || maxDistance <= 0.0f) {
+        return;
+    }
+
+    mUpdateOccupiedCells();
+    if (mOccupiedMax.x < mOccupiedMin.x) {
+        return;
+    }
+
+    mQueryStamp++;
+    const glm::vec2 d = dir / dirLength;
+    const float inf = std::numeric_limits<float>::infinity();
+    const glm::vec2 invDir = glm::vec2(d.x != 0.0f ? 1.0f / d.x : inf, d.y != 0.0f ? 1.0f / d.y : inf);
+
+    // Only the part of the ray inside the occupied cells is walked, so it ends even for infinite maxDistance
+    const glm::vec2 occupiedMin = glm::vec2(mOccupiedMin)*mCellSize;
+    const glm::vec2 occupiedMax = glm::vec2(mOccupiedMax + glm::ivec2(1, 1))*mCellSize;
+    float tEnter;
+    if (!intersectRayAABB(origin, invDir, occupiedMin, occupiedMax, maxDistance, tEnter)) {
+        return;
+    }
+    float tExit = maxDistance;
+    for (int i = 0; i < 2; i++) {
+        if (d[i] != 0.0f) {
+            tExit = std::min(tExit, ((d[i] > 0.0f ? occupiedMax[i] : occupiedMin[i]) - origin[i])*invDir[i]);
+        }
+    }
+
+    // Amanatides-Woo grid traversal
+    glm::ivec2 cell = glm::clamp(mGetCell(origin + d*tEnter), mOccupiedMin, mOccupiedMax);
+    const glm::ivec2 step = glm::ivec2(d.x > 0.0f ? 1 : -1, d.y > 0.0f ? 1 : -1);
+    glm::vec2 tMax, tDelta;
+    for (int i = 0; i < 2; i++) {
+        if (d[i] != 0.0f) {
+            float border = static_cast<float>(cell[i] + (step[i] > 0 ? 1 : 0))*mCellSize;
+            tMax[i] = (border - origin[i])*invDir[i];
+            tDelta[i] = mCellSize*std::abs(invDir[i]);
+        }
+        else {
+            tMax[i] = inf;
+            tDelta[i] = inf;
+        }
+    }
+
+    size_t first = result.size();
+    float t = tEnter;
+    while (t <= tExit) {
+        auto it = mCells.find(mGetCellKey(cell.x, cell.y));
+        if (it != mCells.end()) {
+            for (auto &proxy : it->second) {
+                if (proxy->mQueryStamp == mQueryStamp) {
+                    continue;
+                }
+                proxy->mQueryStamp = mQueryStamp;
+
+                float distance;
+                if (intersectRayAABB(origin, invDir, proxy->mMin, proxy->mMax, maxDistance, distance)) {
+                    SpatialRayHit hit;
+                    hit.proxy = proxy;
+                    hit.distance = distance;
+                    hit.point = origin + d*distance;
+                    result.push_back(hit);
+                }
+            }
+        }
+
+        if (tMax.x < tMax.y) {
+            t = tMax.x;
+            tMax.x += tDelta.x;
+            cell.x += step.x;
+        }
+        else {
+            t = tMax.y;
+            tMax.y += tDelta.y;
+            cell.y += step.y;
+        }
+    }
+
+    std::sort(result.begin() + first, result.end(), [](const SpatialRayHit &a, const SpatialRayHit &b) {
+        return a.distance < b.distance;
+    });
+}
+
+void SpatialIndex::setCellSize(float size) {
+    if (size <= 0.0f) {
+        HD_LOG_WARNING("Invalid SpatialIndex cell size {}", size);
+        return;
+    }
+
+    for (auto &proxy : mProxies) {
+        mRemoveFromCells(proxy);
+    }
+    mCellSize = size;
+    for (auto &proxy : mProxies) {
+        mUpdateProxy(proxy);
+    }
+}
+
+float SpatialIndex::getCellSize() const {
+    return mCellSize;
+}
+
+size_t SpatialIndex::getProxiesCount() const {
+    return mProxies.size();
+}
+
+void SpatialIndex::mAddProxy(SpatialProxy *proxy) {
+    proxy->mProxyIndex = mProxies.size();
+    mProxies.push_back(proxy);
+    mUpdateProxy(proxy);
+}
+
+void SpatialIndex::mRemoveProxy(SpatialProxy *proxy) {
+    mRemoveFromCells(proxy);
+
+    SpatialProxy *last = mProxies.back();
+    mProxies[proxy->mProxyIndex] = last;
+    last->mProxyIndex = proxy->mProxyIndex;
+    mProxies.pop_back();
+}
+
+void SpatialIndex::mUpdateProxy(SpatialProxy *proxy) {
+    const GameObject *owner = proxy->getOwner();
+    const glm::vec2 halfSize = owner->getSize()*0.5f;
+    const float c = std::abs(std::cos(owner->getWorldAngle()));
+    const float s = std::abs(std::sin(owner->getWorldAngle()));
+    const glm::vec2 extent = glm::vec2(c*halfSize.x + s*halfSize.y, s*halfSize.x + c*halfSize.y);
+    proxy->mMin = owner->getWorldPosition() - extent;
+    proxy->mMax = owner->getWorldPosition() + extent;
+
+    glm::ivec2 cellMin = mGetCell(proxy->mMin);
+    glm::ivec2 cellMax = mGetCell(proxy->mMax);
+    if (cellMin != proxy->mCellMin || cellMax != proxy->mCellMax) {
+        mRemoveFromCells(proxy);
+        proxy->mCellMin = cellMin;
+        proxy->mCellMax = cellMax;
+        mInsertToCells(proxy);
+    }
+}
+
+void SpatialIndex::mInsertToCells(SpatialProxy *proxy) {
+    if (!mIsOccupiedDirty) {
+        bool isEmpty = mOccupiedMax.x < mOccupiedMin.x;
+        mOccupiedMin = isEmpty ? proxy->mCellMin : glm::min(mOccupiedMin, proxy->mCellMin);
+        mOccupiedMax = isEmpty ? proxy->mCellMax : glm::max(mOccupiedMax, proxy->mCellMax);
+    }
+    for (int y = proxy->mCellMin.y; y <= proxy->mCellMax.y; y++) {
+        for (int x = proxy->mCellMin.x; x <= proxy->mCellMax.x; x++) {
+            mCells[mGetCellKey(x, y)].push_back(proxy);
+        }
+    }
+}
+
+void SpatialIndex::mRemoveFromCells(SpatialProxy *proxy) {
+    if (proxy->mCellMax.x >= proxy->mCellMin.x) {
+        mIsOccupiedDirty = true;
+    }
+    for (int y = proxy->mCellMin.y; y <= proxy->mCellMax.y; y++) {
+        for (int x = proxy->mCellMin.x; x <= proxy->mCellMax.x; x++) {
+            auto cell = mCells.find(mGetCellKey(x, y));
+            if (cell == mCells.end()) {
+                continue;
+            }
+            std::vector<SpatialProxy*> &proxies = cell->second;
+            auto it = std::find(proxies.begin(), proxies.end(), proxy);
+            if (it != proxies.end()) {
+                *it = proxies.back();
+                proxies.pop_back();
+            }
+            if (proxies.empty()) {
+                mCells.erase(cell);
+            }
+        }
+    }
+    proxy->mCellMin = glm::ivec2(0, 0);
+    proxy->mCellMax = glm::ivec2(-1, -1);
+}
+
+void SpatialIndex::mUpdateOccupiedCells() {
+    if (!mIsOccupiedDirty) {
+        return;
+    }
+    mIsOccupiedDirty = false;
+    mOccupiedMin = glm::ivec2(0, 0);
+    mOccupiedMax = glm::ivec2(-1, -1);
+    for (auto &proxy : mProxies) {
+        if (proxy->mCellMax.x < proxy->mCellMin.x) {
+            continue;
+        }
+        bool isEmpty = mOccupiedMax.x < mOccupiedMin.x;
+        mOccupiedMin = isEmpty ? proxy->mCellMin : glm::min(mOccupiedMin, proxy->mCellMin);
+        mOccupiedMax = isEmpty ? proxy->mCellMax : glm::max(mOccupiedMax, proxy->mCellMax);
+    }
+}
+
+glm::ivec2 SpatialIndex::mGetCell(const glm::vec2 &pos) const {
+    return glm::ivec2(static_cast<int>(std::floor(pos.x / mCellSize)), static_cast<int>(std::floor(pos.y / mCellSize)));
+}
+
+uint64_t SpatialIndex::mGetCellKey(int x, int y) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "Component.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+#include <unordered_map>
+
+namespace hg {
+
+class SpatialProxy;
+
+struct SpatialRayHit {
+    SpatialProxy *proxy = nullptr;
+    float distance = 0.0f;
+    glm::vec2 point = glm::vec2(0, 0);
+};
+
+class SpatialIndex : public Component {
+    HG_OBJECT(SpatialIndex, Component);
+    friend class SpatialProxy;
+public:
+    void onSaveLoad(hd::JSON &data, bool isLoad) override;
+
+    void queryRegion(const glm::vec2 &min, const glm::vec2 &max, std::vector<SpatialProxy*> &result);
+    void queryRadius(const glm::vec2 &center, float radius, std::vector<SpatialProxy*> &result);
+    void queryRay(const glm::vec2 &origin, const glm::vec2 &dir, float maxDistance, std::vector<SpatialRayHit> &result);
+
+    void setCellSize(float size);
+
+    float getCellSize() const;
+    size_t getProxiesCount() const;
+
+private:
+    void mAddProxy(SpatialProxy *proxy);
+    void mRemoveProxy(SpatialProxy *proxy);
+    void mUpdateProxy(SpatialProxy *proxy);
+    void mInsertToCells(SpatialProxy *proxy);
+    void mRemoveFromCells(SpatialProxy *proxy);
+    void mUpdateOccupiedCells();
+    glm::ivec2 mGetCell(const glm::vec2 &pos) const;
+
+    static uint64_t mGetCellKey(int x, int y);
+
+    float mCellSize = 4.0f;
+    std::unordered_map<uint64_t, std::vector<SpatialProxy*>> mCells;
+    std::vector<SpatialProxy*> mProxies;
+    uint32_t mQueryStamp = 0;
+    // Bounds of the cells holding proxies, rays stop walking the grid once they leave them.
+    // Inserting grows them, removing only marks them to be recomputed by the next ray query
+    glm::ivec2 mOccupiedMin = glm::ivec2(0, 0);
+    glm::ivec2 mOccupiedMax = glm::ivec2(-1, -1);
+    bool mIsOccupiedDirty = false;
+};
+
+}
@@ -0,0 +1,35 @@
+#include "SpatialProxy.hpp"
+#include "SpatialIndex.hpp"
+#include "Scene.hpp"
+
+namespace hg {
+
+SpatialProxy::~SpatialProxy() {
+    if (mIndex) {
+        mIndex->mRemoveProxy(this);
+    }
+}
+
+void SpatialProxy::onCreate() {
+    mIndex = getScene().findComponent<SpatialIndex>();
+    if (!mIndex) {
+        HD_LOG_FATAL("Failed to find 'SpatialIndex' component at Scene");
+    }
+    mIndex->mAddProxy(this);
+}
+
+void SpatialProxy::onTransformUpdate() {
+    if (mIndex) {
+        mIndex->mUpdateProxy(this);
+    }
+}
+
+const glm::vec2 &SpatialProxy::getMin() const {
+    return mMin;
+}
+
+const glm::vec2 &SpatialProxy::getMax() const {
+    return mMax;
+}
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "Component.hpp"
+#include <glm/glm.hpp>
+
+namespace hg {
+
+class SpatialIndex;
+
+// Keeps world AABB of the owner (from world position, size and world angle) registered at the scene SpatialIndex
+class SpatialProxy : public Component {
+    HG_OBJECT(SpatialProxy, Component);
+    friend class SpatialIndex;
+public:
+    ~SpatialProxy();
+
+    void onCreate() override;
+    void onTransformUpdate() override;
+
+    const glm::vec2 &getMin() const;
+    const glm::vec2 &getMax() const;
+
+private:
+    SpatialIndex *mIndex = nullptr;
+    glm::vec2 mMin = glm::vec2(0, 0);
+    glm::vec2 mMax = glm::vec2(0, 0);
+    glm::ivec2 mCellMin = glm::ivec2(0, 0);
+    glm::ivec2 mCellMax = glm::ivec2(-1, -1);
+    size_t mProxyIndex = 0;
+    uint32_t mQueryStamp = 0;
+};
+
+}
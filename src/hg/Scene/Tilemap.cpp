@@ -0,0 +1,445 @@
+#include "Tilemap.hpp"
+#include "GameObject.hpp"
+#include "Scene.hpp"
+#include "PhysicsWorld.hpp"
+#include "../Core/Engine.hpp"
+#include "../Core/Profiler.hpp"
+#include "../Renderer2D/RenderSystem2D.hpp"
+#include "hd/Math/MathUtils.hpp"
+#include <cmath>
+
+namespace hg {
+
+// Outline edges go counterclockwise around solid tiles: right, up, left, down
+static const glm::ivec2 gDirections[] = {
+    glm::ivec2(1, 0), glm::ivec2(0, 1), glm::ivec2(-1, 0), glm::ivec2(0, -1)
+};
+
+static const int VERTS_PER_ROW = Tilemap::CHUNK_SIZE + 1;
+
+Tilemap::~Tilemap() {
+    for (auto &it : mChunks) {
+        mDestroyCollider(it.second);
+    }
+}
+
+void Tilemap::onSaveLoad(hd::JSON &data, bool isLoad) {
+    hd::JSON &tileset = data["tileset"];
+    hd::JSON &tilesetColumns = data["tilesetColumns"];
+    hd::JSON &tilesetRows = data["tilesetRows"];
+    hd::JSON &tileSize = data["tileSize"];
+    hd::JSON &layer = data["layer"];
+    hd::JSON &collisionEnabled = data["isCollisionEnabled"];
+    hd::JSON &chunks = data["chunks"];
+
+    if (isLoad) {
+        setTileset(tileset.get<std::string>(), glm::ivec2(tilesetColumns.get<int>(), tilesetRows.get<int>()));
+        setTileSize(tileSize.get<float>());
+        setLayer(layer.get<int>());
+        setCollisionEnabled(collisionEnabled.get<bool>());
+
+        clear();
+        for (auto &it : chunks) {
+            glm::ivec2 origin = glm::ivec2(it["x"].get<int>(), it["y"].get<int>())*CHUNK_SIZE;
+            hd::JSON &tiles = it["tiles"];
+            for (int i = 0; i < CHUNK_SIZE*CHUNK_SIZE && i < static_cast<int>(tiles.size()); i++) {
+                setTile(origin + glm::ivec2(i % CHUNK_SIZE, i / CHUNK_SIZE), tiles[i].get<uint16_t>());
+            }
+        }
+    }
+    else {
+        tileset = mTexturePath;
+        tilesetColumns = mTilesetGridSize.x;
+        tilesetRows = mTilesetGridSize.y;
+        tileSize = mTileSize;
+        layer = mLayer;
+        collisionEnabled = mIsCollisionEnabled;
+
+        chunks = hd::JSON::array();
+        for (const auto &it : mChunks) {
+            const Chunk &chunk = it.second;
+            if (chunk.tilesCount == 0) {
+                continue;
+            }
+            hd::JSON chunkData;
+            chunkData["x"] = chunk.coord.x;
+            chunkData["y"] = chunk.coord.y;
+            hd::JSON &tiles = chunkData["tiles"];
+            tiles = hd::JSON::array();
+            for (uint16_t tile : chunk.tiles) {
+                tiles.push_back(tile);
+            }
+            chunks.push_back(chunkData);
+        }
+    }
+}
+
+void Tilemap::onCreate() {
+    mWorld = PhysicsWorld::findNearest(getOwner());
+}
+
+void Tilemap::onTransformUpdate() {
+    for (auto &it : mChunks) {
+        if (it.second.body) {
+            it.second.body->SetTransform(b2Vec2(getOwner()->getWorldPosition().x, getOwner()->getWorldPosition().y), getOwner()->getWorldAngle());
+        }
+    }
+}
+
+void Tilemap::onUpdate(float dt) {
+    HG_PROFILE_SCOPE("Tilemap::onUpdate");
+    // Only chunks touched since the last frame are rebuilt
+    for (uint64_t key : mDirtyChunks) {
+        auto it = mChunks.find(key);
+        if (it != mChunks.end()) {
+            mRebuildChunk(it->second);
+            if (it->second.tilesCount == 0) {
+                mChunks.erase(it);
+            }
+        }
+    }
+    mDirtyChunks.clear();
+
+    if (mTexture) {
+        glm::vec3 pos = glm::vec3(getOwner()->getWorldPosition(), mLayer);
+        for (const auto &it : mChunks) {
+            if (it.second.vertexCount > 0) {
+                getRenderSystem2D().drawMesh(mTexture, it.second.mesh, it.second.vertexCount, pos, getOwner()->getWorldAngle());
+            }
+        }
+    }
+}
+
+void Tilemap::setTile(const glm::ivec2 &cell, uint16_t tile) {
+    glm::ivec2 coord = mGetChunkCoord(cell);
+    Chunk *chunk = mFindChunk(coord);
+    if (!chunk) {
+        if (tile == EMPTY_TILE) {
+            return;
+        }
+        chunk = &mChunks[mGetChunkKey(coord)];
+        chunk->coord = coord;
+    }
+
+    glm::ivec2 local = cell - coord*CHUNK_SIZE;
+    uint16_t &current = chunk->tiles[local.x + local.y*CHUNK_SIZE];
+    if (current == tile) {
+        return;
+    }
+    if (current == EMPTY_TILE) {
+        chunk->tilesCount++;
+    }
+    else if (tile == EMPTY_TILE) {
+        chunk->tilesCount--;
+    }
+    current = tile;
+    mMarkDirty(*chunk);
+
+    // Colliders of the neighbour chunks are built against the tiles on this side of the seam
+    if (local.x == 0 || local.y == 0 || local.x == CHUNK_SIZE - 1 || local.y == CHUNK_SIZE - 1) {
+        for (int y = -1; y <= 1; y++) {
+            for (int x = -1; x <= 1; x++) {
+                glm::ivec2 neighbourCoord = mGetChunkCoord(cell + glm::ivec2(x, y));
+                Chunk *neighbour = neighbourCoord != coord ? mFindChunk(neighbourCoord) : nullptr;
+                if (neighbour) {
+                    mMarkDirty(*neighbour);
+                }
+            }
+        }
+    }
+}
+
+void Tilemap::clear() {
+    for (auto &it : mChunks) {
+        mDestroyCollider(it.second);
+    }
+    mChunks.clear();
+    mDirtyChunks.clear();
+}
+
+void Tilemap::setTileset(const std::string &path, const glm::ivec2 &gridSize) {
+    if (!path.empty() && !getEngine().isHeadless()) {
+        mTexture = getRenderDevice().loadTexture2D(path);
+    }
+    else {
+        mTexture.reset();
+    }
+    mTexturePath = path;
+    mTilesetGridSize = glm::max(gridSize, glm::ivec2(1, 1));
+    for (auto &it : mChunks) {
+        mMarkDirty(it.second);
+    }
+}
+
+void Tilemap::setTileSize(float size) {
+    mTileSize = size;
+    for (auto &it : mChunks) {
+        mMarkDirty(it.second);
+    }
+}
+
+void Tilemap::setLayer(int layer) {
+    mLayer = layer;
+}
+
+void Tilemap::setCollisionEnabled(bool enabled) {
+    mIsCollisionEnabled = enabled;
+    for (auto &it : mChunks) {
+        mMarkDirty(it.second);
+    }
+}
+
+uint16_t Tilemap::getTile(const glm::ivec2 &cell) const {
+    glm::ivec2 coord = mGetChunkCoord(cell);
+    auto it = mChunks.find(mGetChunkKey(coord));
+    if (it == mChunks.end()) {
+        return EMPTY_TILE;
+    }
+    glm::ivec2 local = cell - coord*CHUNK_SIZE;
+    return it->second.tiles[local.x + local.y*CHUNK_SIZE];
+}
+
+glm::ivec2 Tilemap::getCell(const glm::vec2 &worldPos) const {
+    glm::vec2 local = hd::MathUtils::rotate2D(worldPos - getOwner()->getWorldPosition(), -getOwner()->getWorldAngle());
+    return glm::ivec2(static_cast<int>(std::floor(local.x / mTileSize)), static_cast<int>(std::floor(local.y / mTileSize)));
+}
+
+const std::string &Tilemap::getTileset() const {
+    return mTexturePath;
+}
+
+const glm::ivec2 &Tilemap::getTilesetGridSize() const {
+    return mTilesetGridSize;
+}
+
+float Tilemap::getTileSize() const {
+    return mTileSize;
+}
+
+int Tilemap::getLayer() const {
+    return mLayer;
+}
+
+bool Tilemap::isCollisionEnabled() const {
+    return mIsCollisionEnabled;
+}
+
+size_t Tilemap::getChunksCount() const {
+    return mChunks.size();
+}
+
+Tilemap::Chunk *Tilemap::mFindChunk(const glm::ivec2 &coord) {
+    auto it = mChunks.find(mGetChunkKey(coord));
+    return it != mChunks.end() ? &it->second : nullptr;
+}
+
+void Tilemap::mMarkDirty(Chunk &chunk) {
+    if (!chunk.isDirty) {
+        chunk.isDirty = true;
+        mDirtyChunks.push_back(mGetChunkKey(chunk.coord));
+    }
+}
+
+void Tilemap::mRebuildChunk(Chunk &chunk) {
+    chunk.isDirty = false;
+    if (!getEngine().isHeadless()) {
+        mRebuildMesh(chunk);
+    }
+    mRebuildCollider(chunk);
+}
+
+void Tilemap::mRebuildMesh(Chunk &chunk) {
+    // A new buffer instead of updating the old one, the render thread may still draw the previous frame with it
+    mVertices.clear();
+    glm::vec2 uvSize = glm::vec2(1.0f, 1.0f) / glm::vec2(mTilesetGridSize);
+    for (int y = 0; y < CHUNK_SIZE; y++) {
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            uint16_t tile = chunk.tiles[x + y*CHUNK_SIZE];
+            if (tile == EMPTY_TILE) {
+                continue;
+            }
+
+            int index = tile - 1;
+            glm::vec2 uv0 = glm::vec2(index % mTilesetGridSize.x, index / mTilesetGridSize.x)*uvSize;
+            glm::vec2 uv1 = uv0 + uvSize;
+            glm::vec2 p0 = glm::vec2(chunk.coord*CHUNK_SIZE + glm::ivec2(x, y))*mTileSize;
+            glm::vec2 p1 = p0 + glm::vec2(mTileSize, mTileSize);
+            const float quad[] = {
+                p0.x, p1.y, 0.0f, uv0.x, uv0.y, // LeftUp
+                p0.x, p0.y, 0.0f, uv0.x, uv1.y, // LeftDown
+                p1.x, p1.y, 0.0f, uv1.x, uv0.y, // RightUp
+
+                p1.x, p1.y, 0.0f, uv1.x, uv0.y, // RightUp
+                p0.x, p0.y, 0.0f, uv0.x, uv1.y, // LeftDown
+                p1.x, p0.y, 0.0f, uv1.x, uv1.y, // RightDown
+            };
+            mVertices.insert(mVertices.end(), std::begin(quad), std::end(quad));
+        }
+    }
+
+    chunk.vertexCount = static_cast<uint32_t>(mVertices.size() / 5);
+    chunk.mesh = chunk.vertexCount > 0 ? Buffer::create(mVertices.data(), mVertices.size()*sizeof(float)) : nullptr;
+}
+
+void Tilemap::mRebuildCollider(Chunk &chunk) {
+    mDestroyCollider(chunk);
+    if (!mIsCollisionEnabled || !mWorld || chunk.tilesCount == 0) {
+        return;
+    }
+
+    // Every edge between a solid tile of the chunk and an empty one, keyed by its start vertex. Tiles past the border
+    // are looked up in the neighbour chunks, so a surface crossing chunks has no edges at the seam to catch bodies on
+    glm::ivec2 firstCell = chunk.coord*CHUNK_SIZE;
+    uint8_t outgoing[VERTS_PER_ROW*VERTS_PER_ROW] = {};
+    int8_t openEnds[VERTS_PER_ROW*VERTS_PER_ROW] = {}; // outgoing minus incoming edges, open chains start where it's positive
+    auto isSolid = [this, &chunk, &firstCell](int x, int y) {
+        if (x >= 0 && y >= 0 && x < CHUNK_SIZE && y < CHUNK_SIZE) {
+            return chunk.tiles[x + y*CHUNK_SIZE] != EMPTY_TILE;
+        }
+        return getTile(firstCell + glm::ivec2(x, y)) != EMPTY_TILE;
+    };
+    // Also true for edges of the neighbour chunks, vertex can be outside of this one
+    auto hasEdge = [&isSolid](const glm::ivec2 &vertex, int dir) {
+        switch (dir) {
+            case 0: return isSolid(vertex.x, vertex.y) && !isSolid(vertex.x, vertex.y - 1);
+            case 1: return isSolid(vertex.x - 1, vertex.y) && !isSolid(vertex.x, vertex.y);
+            case 2: return isSolid(vertex.x - 1, vertex.y - 1) && !isSolid(vertex.x - 1, vertex.y);
+            default: return isSolid(vertex.x, vertex.y - 1) && !isSolid(vertex.x - 1, vertex.y - 1);
+        }
+    };
+    auto addEdge = [&outgoing, &openEnds](const glm::ivec2 &vertex, int dir) {
+        glm::ivec2 end = vertex + gDirections[dir];
+        outgoing[vertex.x + vertex.y*VERTS_PER_ROW] |= 1 << dir;
+        openEnds[vertex.x + vertex.y*VERTS_PER_ROW]++;
+        openEnds[end.x + end.y*VERTS_PER_ROW]--;
+    };
+    for (int y = 0; y < CHUNK_SIZE; y++) {
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            if (!isSolid(x, y)) {
+                continue;
+            }
+            if (!isSolid(x, y - 1)) {
+                addEdge(glm::ivec2(x, y), 0);
+            }
+            if (!isSolid(x + 1, y)) {
+                addEdge(glm::ivec2(x + 1, y), 1);
+            }
+            if (!isSolid(x, y + 1)) {
+                addEdge(glm::ivec2(x + 1, y + 1), 2);
+            }
+            if (!isSolid(x - 1, y)) {
+                addEdge(glm::ivec2(x, y + 1), 3);
+            }
+        }
+    }
+
+    b2BodyDef bodyDef;
+    bodyDef.type = b2_staticBody;
+    bodyDef.position = b2Vec2(getOwner()->getWorldPosition().x, getOwner()->getWorldPosition().y);
+    bodyDef.angle = getOwner()->getWorldAngle();
+    chunk.body = mWorld->getWorld().CreateBody(&bodyDef);
+
+    // Edges are chained, then only corners are kept. Surfaces continuing in a neighbour chunk become open chains,
+    // traced first from their start at the seam, everything left closes into loops. Left turns are preferred,
+    // so tiles touching by a corner get separate loops instead of one self-touching loop
+    glm::vec2 origin = glm::vec2(firstCell)*mTileSize;
+    auto toWorld = [&origin, this](const glm::ivec2 &vertex) {
+        glm::vec2 pos = origin + glm::vec2(vertex)*mTileSize;
+        return b2Vec2(pos.x, pos.y);
+    };
+    for (int pass = 0; pass < 2; pass++) {
+        bool isOpen = pass == 0;
+        for (int start = 0; start < VERTS_PER_ROW*VERTS_PER_ROW; start++) {
+            while (outgoing[start] && (!isOpen || openEnds[start] > 0)) {
+                mLoopEdges.clear();
+                glm::ivec2 vertex = glm::ivec2(start % VERTS_PER_ROW, start / VERTS_PER_ROW);
+                int dir = 0;
+                while (!(outgoing[start] & (1 << dir))) {
+                    dir++;
+                }
+                while (dir != -1) {
+                    int index = vertex.x + vertex.y*VERTS_PER_ROW;
+                    mLoopEdges.push_back(std::make_pair(vertex, dir));
+                    outgoing[index] &= ~(1 << dir);
+                    openEnds[index]--;
+                    vertex += gDirections[dir];
+                    index = vertex.x + vertex.y*VERTS_PER_ROW;
+                    openEnds[index]++;
+                    if (!isOpen && index == start) {
+                        break;
+                    }
+
+                    const int turns[] = {(dir + 1) % 4, dir, (dir + 3) % 4};
+                    dir = -1;
+                    for (int turn : turns) {
+                        if (outgoing[index] & (1 << turn)) {
+                            dir = turn;
+                            break;
+                        }
+                    }
+                }
+
+                mLoopVertices.clear();
+                for (size_t i = 0; i < mLoopEdges.size(); i++) {
+                    int prevDir = mLoopEdges[(i + mLoopEdges.size() - 1) % mLoopEdges.size()].second;
+                    if (mLoopEdges[i].second != prevDir || (isOpen && i == 0)) {
+                        mLoopVertices.push_back(toWorld(mLoopEdges[i].first));
+                    }
+                }
+
+                b2ChainShape chain;
+                if (isOpen) {
+                    mLoopVertices.push_back(toWorld(vertex));
+                    chain.CreateChain(mLoopVertices.data(), static_cast<int32>(mLoopVertices.size()));
+
+                    // Ghost vertices on the neighbour's edges, picked the way tracing would, so bodies slide over the seam
+                    glm::ivec2 first = mLoopEdges.front().first;
+                    int firstDir = mLoopEdges.front().second;
+                    for (int prevDir : {(firstDir + 3) % 4, firstDir, (firstDir + 1) % 4}) {
+                        if (hasEdge(first - gDirections[prevDir], prevDir)) {
+                            chain.SetPrevVertex(toWorld(first - gDirections[prevDir]));
+                            break;
+                        }
+                    }
+                    int lastDir = mLoopEdges.back().second;
+                    for (int nextDir : {(lastDir + 1) % 4, lastDir, (lastDir + 3) % 4}) {
+                        if (hasEdge(vertex, nextDir)) {
+                            chain.SetNextVertex(toWorld(vertex + gDirections[nextDir]));
+                            break;
+                        }
+                    }
+                }
+                else if (mLoopVertices.size() >= 3) {
+                    chain.CreateLoop(mLoopVertices.data(), static_cast<int32>(mLoopVertices.size()));
+                }
+                else {
+                    continue;
+                }
+                b2FixtureDef fd;
+                fd.shape = &chain;
+                chunk.body->CreateFixture(&fd);
+            }
+        }
+    }
+}
+
+void Tilemap::mDestroyCollider(Chunk &chunk) {
+    if (chunk.body) {
+        mWorld->getWorld().DestroyBody(chunk.body);
+        chunk.body = nullptr;
+    }
+}
+
+glm::ivec2 Tilemap::mGetChunkCoord(const glm::ivec2 &cell) {
+    // Floor division, so negative cells go to negative chunks
+    return glm::ivec2(
+        cell.x >= 0 ? cell.x / CHUNK_SIZE : (cell.x + 1) / CHUNK_SIZE - 1,
+        cell.y >= 0 ? cell.y / CHUNK_SIZE : (cell.y + 1) / CHUNK_SIZE - 1
+    );
+}
+
+uint64_t Tilemap::mGetChunkKey(const glm::ivec2 &coord) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(coord.x)) << 32) | static_cast<uint32_t>(coord.y);
+}
+
+}
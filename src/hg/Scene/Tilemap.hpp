@@ -0,0 +1,82 @@
+#pragma once
+#include "Component.hpp"
+#include "../Graphics/Texture2D.hpp"
+#include "../Graphics/Buffer.hpp"
+#include "Box2D/Box2D.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <unordered_map>
+
+namespace hg {
+
+class PhysicsWorld;
+
+// Grid of tiles from one tileset texture, in the owner's space with cell (0, 0) at its origin.
+// Tiles are stored and rebuilt per chunk: one vertex buffer and one static body with chains around solid tiles,
+// continuing into the neighbour chunks without edges at the seams
+class Tilemap : public Component {
+    HG_OBJECT(Tilemap, Component);
+public:
+    static const int CHUNK_SIZE = 16;
+    static const uint16_t EMPTY_TILE = 0; // tile N is cell N - 1 of the tileset, row by row from the top left
+
+    ~Tilemap();
+
+    void onSaveLoad(hd::JSON &data, bool isLoad) override;
+    void onCreate() override;
+    void onTransformUpdate() override;
+    void onUpdate(float dt) override;
+
+    void setTile(const glm::ivec2 &cell, uint16_t tile);
+    void clear();
+
+    void setTileset(const std::string &path, const glm::ivec2 &gridSize);
+    void setTileSize(float size);
+    void setLayer(int layer);
+    void setCollisionEnabled(bool enabled);
+
+    uint16_t getTile(const glm::ivec2 &cell) const;
+    glm::ivec2 getCell(const glm::vec2 &worldPos) const;
+    const std::string &getTileset() const;
+    const glm::ivec2 &getTilesetGridSize() const;
+    float getTileSize() const;
+    int getLayer() const;
+    bool isCollisionEnabled() const;
+    size_t getChunksCount() const;
+
+private:
+    struct Chunk {
+        glm::ivec2 coord;
+        uint16_t tiles[CHUNK_SIZE*CHUNK_SIZE] = {};
+        uint32_t tilesCount = 0;
+        bool isDirty = false;
+        BufferPtr mesh;
+        uint32_t vertexCount = 0;
+        b2Body *body = nullptr;
+    };
+
+    Chunk *mFindChunk(const glm::ivec2 &coord);
+    void mMarkDirty(Chunk &chunk);
+    void mRebuildChunk(Chunk &chunk);
+    void mRebuildMesh(Chunk &chunk);
+    void mRebuildCollider(Chunk &chunk);
+    void mDestroyCollider(Chunk &chunk);
+
+    static glm::ivec2 mGetChunkCoord(const glm::ivec2 &cell);
+    static uint64_t mGetChunkKey(const glm::ivec2 &coord);
+
+    std::unordered_map<uint64_t, Chunk> mChunks;
+    std::vector<uint64_t> mDirtyChunks;
+    Texture2DPtr mTexture;
+    std::string mTexturePath;
+    glm::ivec2 mTilesetGridSize = glm::ivec2(1, 1);
+    float mTileSize = 1.0f;
+    int mLayer = 0;
+    bool mIsCollisionEnabled = true;
+    PhysicsWorld *mWorld = nullptr;
+    std::vector<float> mVertices;
+    std::vector<std::pair<glm::ivec2, int>> mLoopEdges;
+    std::vector<b2Vec2> mLoopVertices;
+};
+
+}
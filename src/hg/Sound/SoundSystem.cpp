@@ -1,5 +1,6 @@
 #include "SoundSystem.hpp"
 #include "../Core/Engine.hpp"
+#include "../Core/MemoryTracker.hpp"
 #include "hd/Core/Log.hpp"
 #include "hd/IO/FileStream.hpp"
 #include "SDL2/SDL_mixer.h"
@@ -11,12 +12,14 @@ struct SoundBuffer {
     std::string name;
     std::vector<uint8_t> buf;
     Mix_Chunk *chunk;
+    size_t index;
 };
 
 struct MusicBuffer {
     std::string name;
     std::vector<uint8_t> buf;
     Mix_Music *music;
+    size_t index;
 };
 
 SoundSystem::SoundSystem() {
@@ -31,11 +34,13 @@ SoundSystem::SoundSystem() {
 }
 
 SoundSystem::~SoundSystem() {
-    for (auto &it : mCreatedMusicBuffers) {
-        mDestroyMusic(it);
+    while (!mCreatedMusicBuffers.empty()) {
+        MusicBuffer *buffer = mCreatedMusicBuffers.back();
+        mDestroyMusic(buffer);
     }
-    for (auto &it : mCreatedSoundBuffers) {
-        mDestroySound(it);
+    while (!mCreatedSoundBuffers.empty()) {
+        SoundBuffer *buffer = mCreatedSoundBuffers.back();
+        mDestroySound(buffer);
     }
     Mix_CloseAudio();
     Mix_Quit();
@@ -78,6 +83,7 @@ MusicBuffer *SoundSystem::loadMusic(const std::string &path) {
 }
 
 SoundBuffer *SoundSystem::createSoundFromFile(const std::string &path) {
+    HG_MEMORY_TAG(MemoryTag::Sound);
     if (!path.empty()) {
         SoundBuffer *soundBuffer = new SoundBuffer();
         soundBuffer->name = path;
@@ -92,6 +98,7 @@ SoundBuffer *SoundSystem::createSoundFromFile(const std::string &path) {
             HD_LOG_ERROR("Failed to create sound from file '{}'", path);
         }
 
+        soundBuffer->index = mCreatedSoundBuffers.size();
         mCreatedSoundBuffers.push_back(soundBuffer);
         return soundBuffer;
     }
@@ -102,6 +109,7 @@ SoundBuffer *SoundSystem::createSoundFromFile(const std::string &path) {
 }
 
 MusicBuffer *SoundSystem::createMusicFromFile(const std::string &path) {
+    HG_MEMORY_TAG(MemoryTag::Sound);
     if (!path.empty()) {
         MusicBuffer *musicBuffer = new MusicBuffer();
         musicBuffer->name = path;
@@ -116,6 +124,7 @@ MusicBuffer *SoundSystem::createMusicFromFile(const std::string &path) {
             HD_LOG_ERROR("Failed to create music from file '{}'", path);
         }
 
+        musicBuffer->index = mCreatedMusicBuffers.size();
         mCreatedMusicBuffers.push_back(musicBuffer);
         return musicBuffer;
     }
@@ -130,9 +139,7 @@ void SoundSystem::destroySound(SoundBuffer *&soundBuffer) {
         HD_LOG_WARNING("soundBuffer is nullptr");
     }
     else {
-        auto it = std::find(mCreatedSoundBuffers.begin(), mCreatedSoundBuffers.end(), soundBuffer);
-        if (it != mCreatedSoundBuffers.end()) {
-            mCreatedSoundBuffers.erase(std::remove(mCreatedSoundBuffers.begin(), mCreatedSoundBuffers.end(), soundBuffer), mCreatedSoundBuffers.end());
+        if (soundBuffer->index < mCreatedSoundBuffers.size() && mCreatedSoundBuffers[soundBuffer->index] == soundBuffer) {
             mDestroySound(soundBuffer);
         }
         else {
@@ -146,9 +153,7 @@ void SoundSystem::destroyMusic(MusicBuffer *&musicBuffer) {
         HD_LOG_WARNING("musicBuffer is nullptr");
     }
     else {
-        auto it = std::find(mCreatedMusicBuffers.begin(), mCreatedMusicBuffers.end(), musicBuffer);
-        if (it != mCreatedMusicBuffers.end()) {
-            mCreatedMusicBuffers.erase(std::remove(mCreatedMusicBuffers.begin(), mCreatedMusicBuffers.end(), musicBuffer), mCreatedMusicBuffers.end());
+        if (musicBuffer->index < mCreatedMusicBuffers.size() && mCreatedMusicBuffers[musicBuffer->index] == musicBuffer) {
             mDestroyMusic(musicBuffer);
         }
         else {
@@ -228,7 +233,14 @@ std::string SoundSystem::mGetFullPath(const std::string &path) {
 
 void SoundSystem::mDestroySound(SoundBuffer*& buffer) {
     if (buffer) {
-        mCreatedSoundBuffers.erase(std::remove(mCreatedSoundBuffers.begin(), mCreatedSoundBuffers.end(), buffer), mCreatedSoundBuffers.end());
+        mCreatedSoundBuffers[buffer->index] = mCreatedSoundBuffers.back();
+        mCreatedSoundBuffers[buffer->index]->index = buffer->index;
+        mCreatedSoundBuffers.pop_back();
+
+        auto it = mSoundBuffers.find(hd::StringHash(buffer->name));
+        if (it != mSoundBuffers.end() && it->second == buffer) {
+            mSoundBuffers.erase(it);
+        }
         Mix_FreeChunk(buffer->chunk);
         HD_DELETE(buffer);
     }
@@ -236,7 +248,14 @@ void SoundSystem::mDestroySound(SoundBuffer*& buffer) {
 
 void SoundSystem::mDestroyMusic(MusicBuffer*& buffer) {
     if (buffer) {
-        mCreatedMusicBuffers.erase(std::remove(mCreatedMusicBuffers.begin(), mCreatedMusicBuffers.end(), buffer), mCreatedMusicBuffers.end());
+        mCreatedMusicBuffers[buffer->index] = mCreatedMusicBuffers.back();
+        mCreatedMusicBuffers[buffer->index]->index = buffer->index;
+        mCreatedMusicBuffers.pop_back();
+
+        auto it = mMusicBuffers.find(hd::StringHash(buffer->name));
+        if (it != mMusicBuffers.end() && it->second == buffer) {
+            mMusicBuffers.erase(it);
+        }
         Mix_FreeMusic(buffer->music);
         HD_DELETE(buffer);
     }
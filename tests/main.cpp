@@ -0,0 +1,162 @@
+#include "../src/hg/Core/Engine.hpp"
+#include "../src/hg/Scene/Scene.hpp"
+#include "../src/hg/Scene/PhysicsWorld.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Headless checks of engine behavior that can't be seen in the benchmarks.
+// Usage: HgEngineTests. Returns non-zero if any check fails
+
+namespace hg {
+
+// Destroys the TestVictim component of its owner from onFirstUpdate
+class TestKiller : public Component {
+    HG_OBJECT(TestKiller, Component);
+public:
+    void onFirstUpdate() override;
+};
+
+class TestVictim : public Component {
+    HG_OBJECT(TestVictim, Component);
+public:
+    void onFirstUpdate() override {
+        firstUpdatesCount++;
+    }
+
+    static int firstUpdatesCount;
+};
+
+int TestVictim::firstUpdatesCount = 0;
+
+void TestKiller::onFirstUpdate() {
+    getOwner()->destroyComponent<TestVictim>();
+}
+
+}
+
+namespace {
+
+int gFailedChecksCount = 0;
+
+#define HG_CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            gFailedChecksCount++; \
+        } \
+    } while (false)
+
+void writeFile(const std::string &path, const std::string &data) {
+    std::ofstream("./data/levels/" + path, std::ios::binary) << data;
+}
+
+// Runs scene updates until the async load finishes or the timeout expires
+bool waitLoading(hg::Scene &scene) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (scene.isLoading() && std::chrono::steady_clock::now() < deadline) {
+        scene.onUpdate(0.0f);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return !scene.isLoading();
+}
+
+void testAsyncLoadCorruptLevel() {
+    hg::Scene &scene = hg::getScene();
+    scene.clear();
+
+    const std::vector<std::pair<std::string, std::string>> levels = {
+        { "corrupt_text.json", "{ \"name\": \"root\", \"children\": [" },
+        { "corrupt_keys.json", "{ \"name\": \"root\" }" },
+        { "corrupt_archive.hgba", std::string("HGBA\x01\x00\xFF\xFF", 8) },
+    };
+    for (const auto &[path, data] : levels) {
+        writeFile(path, data);
+        scene.loadAsync(path);
+        HG_CHECK(waitLoading(scene));
+        HG_CHECK(scene.getChildren().empty());
+    }
+}
+
+void testDestroyComponentInFirstUpdate() {
+    hg::Scene &scene = hg::getScene();
+    scene.clear();
+    hg::TestVictim::firstUpdatesCount = 0;
+
+    hg::GameObject *go = scene.createChild();
+    go->createComponent<hg::TestKiller>();
+    go->createComponent<hg::TestVictim>();
+    scene.onUpdate(0.0f);
+    scene.onUpdate(0.0f);
+    HG_CHECK(hg::TestVictim::firstUpdatesCount == 0);
+    HG_CHECK(!go->findComponent<hg::TestVictim>());
+    scene.clear();
+}
+
+void testPhysicsSnapshotDeterminism() {
+    hg::Scene &scene = hg::getScene();
+    scene.clear();
+
+    hg::GameObject *root = scene.createChild();
+    hg::PhysicsWorld *world = root->createComponent<hg::PhysicsWorld>();
+    world->setGravity(glm::vec2(0, -10));
+    world->setDeterministic(true);
+
+    hg::GameObject *ground = root->createChild();
+    ground->setSize(40.0f, 1.0f);
+    ground->createComponent<hg::RigidBody>()->setType(hg::BodyType::Static);
+    for (int i = 0; i < 10; i++) {
+        hg::GameObject *box = root->createChild();
+        box->setPosition(0.3f*(i % 3), 1.0f + 1.1f*i);
+        box->setAngle(0.1f*i);
+        hg::RigidBody *body = box->createComponent<hg::RigidBody>();
+        body->setType(hg::BodyType::Dynamic);
+        body->setShapeDensity(1.0f);
+    }
+
+    // Boxes are falling and colliding, the second run starts with contacts left from other steps
+    world->simulate(30);
+    hg::PhysicsSnapshot start, first, second;
+    world->saveSnapshot(start);
+    HG_CHECK(world->restoreSnapshot(start));
+    world->simulate(60);
+    world->saveSnapshot(first);
+    world->simulate(20);
+    HG_CHECK(world->restoreSnapshot(start));
+    world->simulate(60);
+    world->saveSnapshot(second);
+
+    HG_CHECK(first.getDataSize() == second.getDataSize());
+    HG_CHECK(first.getDataSize() == second.getDataSize() && std::memcmp(first.getData(), second.getData(), first.getDataSize()) == 0);
+    scene.clear();
+}
+
+}
+
+int main() {
+    std::filesystem::create_directories("./data/levels");
+
+    hg::EngineCreateInfo createInfo;
+    createInfo.isHeadless = true;
+    hg::getEngine().initialize(createInfo, hg::BaseApp::getTypeHashStatic());
+
+    const std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        { "async_load_corrupt_level", testAsyncLoadCorruptLevel },
+        { "destroy_component_in_first_update", testDestroyComponentInFirstUpdate },
+        { "physics_snapshot_determinism", testPhysicsSnapshotDeterminism },
+    };
+    for (const auto &[name, test] : tests) {
+        int failedBefore = gFailedChecksCount;
+        test();
+        std::fprintf(stderr, "%-32s %s\n", name, gFailedChecksCount == failedBefore ? "ok" : "FAILED");
+    }
+
+    hg::getEngine().shutdown();
+    return gFailedChecksCount == 0 ? 0 : 1;
+}